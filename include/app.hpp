@@ -5,6 +5,13 @@
 #include "window.hpp"
 #include "console.hpp"
 #include "renderer.hpp"
+#include "soft_renderer.hpp"
+#include "scheduler.hpp"
+#include "history.hpp"
+#include "sweep.hpp"
+#include "search.hpp"
+#include "domain.hpp"
+#include "bench.hpp"
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -16,7 +23,7 @@ class Application {
         Application();
         ~Application();
 
-        void run();
+        void run(int argc, char** argv);
         static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
         static void char_callback(GLFWwindow* window, unsigned int codepoint);
         static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -27,20 +34,34 @@ class Application {
         void set_window_icon_from_resource(GLFWwindow* window);
 
         void loadConfig();
+        void applyArgs();
         void initGrid();
         void initWindow();
         void initGlad();
         void initRender();
         void initConsole();
         void mainLoop();
+        void runHeadless();
+        void runDomain();
+        void runBatch();
 
         std::unique_ptr<Config> cfg;
         std::unique_ptr<Window> window;
         std::unique_ptr<Grid> grid;
         std::unique_ptr<Console> console;
         std::unique_ptr<Renderer> renderer;
+        std::unique_ptr<Scheduler> scheduler;
+        std::unique_ptr<History> history;
+        std::unique_ptr<Domain> domain;
+
+        // Command line, and generations of a batch run (--steps), 0 to open the window
+        std::vector<std::string> args;
+        int batchSteps = 0;
 
         int fbWidth, fbHeight;
 
+        // Seconds between two checks of 'config.jsonc' for changes
+        static constexpr double reloadInterval = 0.5;
+
         std::string title = "GOL";
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "gol_shm.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+
+// Aligned memory block split in equal slots, used to back the grid buffers.
+// Slots of 2 MB or more are aligned on huge pages and advised as such on Linux.
+// The memory is reused as long as the requested size fits in the current block, and is never zeroed:
+// the owner is expected to do the first touch from the threads that will use each part of it.
+// In shared mode the block is a POSIX shared memory segment with the layout of gol_shm.h, for readers in other processes:
+// the owner marks the slots it writes and publishes them, readers check the sequence of their slot instead of locking.
+class GridArena {
+    public:
+        GridArena();
+        ~GridArena();
+
+        GridArena(const GridArena&) = delete;
+        GridArena& operator=(const GridArena&) = delete;
+
+        void reserve(size_t words, int slots);
+        std::span<uint64_t> slot(int i) const;
+
+        void share(const std::string& name);
+        void beginWrite(int slot);
+        void publish(int slot, uint64_t generation, int width, int height, int rows, int wordsPerRow);
+
+        size_t capacityBytes() const;
+        bool hugePages() const;
+
+        static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+    private:
+        void release();
+        void createShared(size_t stride);
+
+        uint64_t* base = nullptr;
+        size_t capacity = 0;
+        size_t slotStride = 0;
+        size_t slotWords = 0;
+        int slotCount = 0;
+        bool huge = false;
+
+        // Shared mode: name of the segment and its header, nullptr otherwise
+        std::string shmName;
+        gol_shm_header* header = nullptr;
+        size_t mapBytes = 0;
+};
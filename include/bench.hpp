@@ -0,0 +1,95 @@
+#pragma once
+
+#include "config.hpp"
+#include "grid.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hardware counters of a run. A counter the machine or the permissions do not give stays unavailable
+struct PerfCounts {
+    enum Counter { Cycles, Instructions, L1Misses, LLCMisses, BranchMisses, Count };
+    uint64_t values[Count] = {};
+    bool available[Count] = {};
+    std::string error;      // why the counters are missing, empty when all are available
+};
+
+// Timing of one kernel
+struct BenchResult {
+    std::string kernel;
+    int steps = 0;
+    uint64_t cells = 0;     // cells per step
+    double seconds = 0.0;
+    double cellsPerSecond = 0.0;
+    uint64_t hash = 0;      // grid hash after the last step, equal for every kernel
+    PerfCounts counts;
+};
+
+// Linux perf_event_open counters of the calling thread and of the threads it creates afterwards: to count the workers
+// of a grid, the counters are opened before the grid starts its threads. Elsewhere every counter is unavailable
+class PerfCounters {
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        void start();
+        PerfCounts stop();
+
+    private:
+        // Counter value, and times enabled and running to scale multiplexed counters
+        struct Reading {
+            uint64_t value = 0;
+            uint64_t enabled = 0;
+            uint64_t running = 0;
+        };
+        bool read(int i, Reading& r) const;
+
+        int fds[PerfCounts::Count];
+        Reading begin[PerfCounts::Count];
+        std::string error;
+};
+
+// Run of one kernel on a private grid, advanced by chunks of steps so that the caller keeps control between them.
+// The time and the hardware counters only cover the steps
+class BenchRun {
+    public:
+        BenchRun(const Config* cfg, const std::string& kernel, int steps);
+        ~BenchRun();
+
+        BenchRun(const BenchRun&) = delete;
+        BenchRun& operator=(const BenchRun&) = delete;
+
+        bool advance(double budget);
+        int stepsDone() const;
+        BenchResult result() const;
+
+    private:
+        Config local;
+        PerfCounters perf;      // before the grid, so its worker threads are counted
+        Grid grid;
+        std::string kernel;
+        int steps = 0;
+        int done = 0;
+        double seconds = 0.0;
+        PerfCounts counts;
+};
+
+// Kernel benchmark: every step kernel runs the same random grid of the configured size, with the configured threads
+class Benchmark {
+    public:
+        Benchmark(const Config* cfg);
+        ~Benchmark();
+
+        static const std::vector<std::string>& kernels();
+
+        BenchResult runKernel(const std::string& kernel, int steps);
+        std::vector<BenchResult> run(int steps);
+        static std::string report(const std::vector<BenchResult>& results);
+
+    private:
+        const Config* cfg = nullptr;
+};
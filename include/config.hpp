@@ -4,6 +4,9 @@
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 #include <utility>
+#include <string>
+#include <vector>
+#include <filesystem>
 
 using json = nlohmann::json;
 
@@ -16,26 +19,86 @@ class Config {
         int height = 600;
         int gridx = 500;
         int gridy = 500;
+        bool unbounded = false;
+        int threads = 0;
+        std::string kernel = "adder";
         std::string rulestr = "B3S23";
         uint16_t born_rule = 0, survive_rule = 0;
         bool randomSeed = false;
         int seed = 1234;
         std::string distType = "uniform";
         float density = 0.5f;
+        double speed = 0.0;
         bool checker = false;
         bool showfps = true;
+        bool hotReload = true;
         bool vsync = false;
+        bool heatmap = false;
         bool freeze_at_start = true;
+        bool history = true;
+        int historyMemory = 64;
+        int historyKeyframes = 32;
+        bool sweep = false;
+        std::vector<std::string> sweepRulesets = {"B3S23", "B36S23"};
+        std::vector<std::string> sweepDists = {"bernoulli"};
+        std::vector<float> sweepDensities = {0.3f, 0.5f};
+        std::vector<int> sweepSeeds = {1, 2, 3};
+        int sweepSteps = 10000;
+        int sweepPeriod = 16;
+        std::string sweepOutput = "sweep.csv";
+        std::string sweepFormat = "csv";
+        bool search = false;
+        std::string searchRuleset = "B3S23";
+        std::string searchMode = "random";
+        int searchSoups = 10000;
+        int searchSoupSize = 16;
+        float searchDensity = 0.5f;
+        int searchGrid = 128;
+        int searchSteps = 4000;
+        int searchPeriod = 64;
+        int searchSeed = 1;
+        std::string searchOutput = "search.rle";
+        bool domain = false;
+        int domainRank = 0;
+        int domainRanks = 2;
+        std::string domainTransport = "tcp";
+        std::string domainHost = "127.0.0.1";
+        int domainPort = 47000;
+        std::string domainName = "gol_halo";
+        int domainSteps = 1000;
+        bool shm = false;
+        std::string shmName = "game_of_life";
+        bool benchmark = false;
+        int benchSteps = 1000;
+        bool headless = false;
+        int exportFrames = 300;
+        int exportSteps = 1;
+        int exportWidth = 1920;
+        int exportHeight = 1080;
+        float exportZoom = 1.0f;
+        std::vector<float> exportCamera = {0.0f, 0.0f};
+        std::string exportOutput = "frames.rgba";
+        std::string exportFormat = "raw";
         
         void initConfig(const std::string& path);
+        bool changedOnDisk() const;
+        std::vector<std::string> reload();
         std::pair<bool, std::string> parseRuleset(std::string rawrulestr);
         std::pair<bool, std::string> parseDistType(std::string disttyp);
+        std::pair<bool, std::string> parseKernel(std::string name);
         void printAllParams() const;
+        json toJson() const;
 
         GLFWwindow* window = nullptr;
 
+        // Problems found by the last load, one line per key
+        std::vector<std::string> errors;
+
     private:
         std::string path;
+        std::filesystem::file_time_type loadedTime;
+        // Values of the file when last read, command line overrides are kept until the file changes the same key
+        json onDisk;
         void saveConfig(const std::string& path);
         void loadConfig(const std::string& path);
         void printJsonRecursive(const json& j, int indent = 0, const std::string& prefix = "") const;
@@ -5,6 +5,10 @@
 #include "window.hpp"
 #include "grid.hpp"
 #include "renderer.hpp"
+#include "scheduler.hpp"
+#include "history.hpp"
+#include "bench.hpp"
+#include "trace.hpp"
 
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
@@ -15,15 +19,19 @@
 
 class Console {
     public:
-        Console(Config* cfg, Window* win, Grid* grid, Renderer* renderer);
+        Console(Config* cfg, Window* win, Grid* grid, Renderer* renderer, Scheduler* scheduler, History* history);
         ~Console();
 
         void initConsole();
         void draw();
+        void update();
+        double nextWakeTime() const;
+        bool hasTask() const;
         void log(const std::string& s);
         void execute(const std::string& command);
         void handleInput(int key, int action);
         void handleChar(unsigned int codepoint);
+        void reloadConfig();
         void cleanup();
 
         float cWidth, cHeight;
@@ -56,6 +64,21 @@ class Console {
         CommandNode root;
 
     private:
+        // Cooperative task advanced by the main loop, one slice per frame. advance() returns true when the task is over,
+        // it can sleep by moving wakeTime forward
+        struct Task {
+            std::string name;
+            std::function<bool(Task&)> advance;
+            double wakeTime = 0.0;
+        };
+        static constexpr double taskBudget = 0.010;  // seconds of work per frame
+
+        void enqueue(const std::string& name, std::function<bool(Task&)> advance);
+        void progress(const std::string& s, bool last = false);
+
+        std::deque<Task> tasks;
+        bool progressLine = false;
+
         template<typename T>
         std::optional<T> from_string(const std::string& s);
 
@@ -63,19 +86,29 @@ class Console {
         void executeCommand(const CommandNode& root, const std::vector<std::string>& tokens);
         std::vector<std::string> suggest(const CommandNode& root, const std::vector<std::string>& tokens, bool endsWithSpace);
 
-        void appendText(std::vector<float>& pts, int x, int y, const std::string& text);
+        void initAtlas();
+        void appendText(std::vector<float>& glyphs, int x, int y, const std::string& text);
+        void drawGlyphs(const GLBuffer& buffer, size_t count, float r, float g, float b, float a);
 
         void command_start();
         void command_stop();
         void command_regen();
         void command_step(int n_step = 1, float delay = 0.0);
+        void command_bench(int n_step);
+        void command_trace(const std::string& action, const std::string& path = "");
         void setWindowSize(int w, int h);
-        void setGridSize(int x, int y);
+        void setGridSize(int x, int y, bool centered = true);
         void setRuleset(std::string rulestr);
         void setSeed(bool isRandom = true, int seed = 0);
+        void setHeatmap(bool on);
+        void setKernel(std::string name);
+        void setSpeed(double gensPerSecond);
+        void getSpeed();
         void setDistrib(std::string distType = "uniform", float density = 0.5);
         void getWindowSize();
         void getGridSize();
+        void getWorld();
+        void getHistory();
 
         std::string input = "";
         std::string suggestionText = "";
@@ -83,16 +116,33 @@ class Console {
         std::string prefix;
         bool endsWithSpace = false;
         
-        std::vector<float> ptsInput;
-        std::vector<float> ptsSuggest;
-        std::vector<float> pts;
+        // Glyph instances: x, y of the top left pixel and character code
+        std::vector<float> glyphsInput;
+        std::vector<float> glyphsSuggest;
+        std::vector<float> glyphsLogs;
+
+        // Log glyphs are only rebuilt when the lines or the scrolling change
+        bool logsDirty = true;
+        int cachedOffset = -1;
+        int cachedVisible = -1;
         
         std::unique_ptr<GLVertexBuffer> vao;
         std::unique_ptr<GLBuffer> vbo;
+        std::unique_ptr<GLProgram> shaders;
+        int uScreen = -1;
+        int uColor = -1;
+
+        // Text drawn as instanced quads sampling a glyph atlas
+        std::unique_ptr<GLVertexBuffer> vaoText;
+        std::unique_ptr<GLBuffer> vboQuad;
         std::unique_ptr<GLBuffer> vboLogs;
         std::unique_ptr<GLBuffer> vboInput;
         std::unique_ptr<GLBuffer> vboSuggest;
-        std::unique_ptr<GLProgram> shaders;
+        std::unique_ptr<GLTexture2D> atlas;
+        std::unique_ptr<GLProgram> textShaders;
+        int uTextScreen = -1;
+        int uTextColor = -1;
+        int uAtlas = -1;
         
         int fbWidth, fbHeight;
 
@@ -100,4 +150,6 @@ class Console {
         Window* win;
         Grid* grid;
         Renderer* renderer;
+        Scheduler* scheduler;
+        History* history;
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Domain decomposition of the grid in horizontal stripes, one per process (rank).
+// Each stripe keeps the grid layout, its padding rows being the halos: before each step, the first and last rows
+// of the stripe are sent to the neighbour ranks and their boundary rows are received in the padding rows.
+// The exchange runs on a background thread while the inner rows are computed.
+// Transports: TCP (rank r listens on port + r for rank r + 1) or POSIX shared memory (one segment per boundary).
+class Domain {
+    public:
+        Domain(Config* cfg);
+        ~Domain();
+
+        Domain(const Domain&) = delete;
+        Domain& operator=(const Domain&) = delete;
+
+        void initStripe();
+        void connect(int words);
+
+        void beginExchange(uint64_t* grid, int rows, int words);
+        void waitExchange();
+        uint64_t sum(uint64_t value);
+
+        int rank = 0;
+        int ranks = 1;
+
+        // Global rows [firstRow, firstRow + stripeRows) owned by this rank
+        int firstRow = 0;
+        int stripeRows = 0;
+
+        // Time spent waiting for the halos after the inner rows were done, in seconds
+        double waitTime = 0.0;
+
+    private:
+        // Connection to a neighbour rank. The lower rank of a link sends first, the upper one receives first
+        struct Link {
+            bool active = false;
+            bool lower = false;
+            intptr_t sock = -1;
+            // Shared memory: mapped segment, outgoing and incoming channels
+            void* map = nullptr;
+            size_t mapBytes = 0;
+            unsigned char* out = nullptr;
+            unsigned char* in = nullptr;
+        };
+
+        void connectTcp(int words);
+        void connectShm(int words);
+        void closeLink(Link& link);
+
+        void sendRow(Link& link, const uint64_t* row, size_t words);
+        void recvRow(Link& link, uint64_t* row, size_t words);
+        void exchangeLink(Link& link, const uint64_t* sendRow, uint64_t* recvRow, size_t words);
+        void exchange();
+        void loop();
+
+        Config* cfg = nullptr;
+        bool shm = false;
+        Link up;     // rank - 1, owns the rows above
+        Link down;   // rank + 1, owns the rows below
+
+        // Exchange handed over to the background thread
+        std::thread worker;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable done;
+        uint64_t* grid = nullptr;
+        int rows = 0;
+        int words = 0;
+        bool busy = false;
+        bool quit = false;
+        std::string error;
+};
@@ -3,6 +3,11 @@
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
 class GLVertexBuffer {
     public:
         GLVertexBuffer();
@@ -62,6 +67,24 @@ private:
     GLuint bufID = 0;
 };
 
+class GLTexture2D {
+    public:
+        GLTexture2D();
+        ~GLTexture2D();
+
+        void bind(GLuint unit = 0) const;
+        void allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data = nullptr);
+
+        GLTexture2D(const GLTexture2D&) = delete;
+        GLTexture2D& operator=(const GLTexture2D&) = delete;
+
+        GLTexture2D(GLTexture2D&& other) noexcept;
+        GLTexture2D& operator=(GLTexture2D&& other) noexcept;
+
+    private:
+        GLuint id = 0;
+};
+
 class GLProgram {
     public:
         GLProgram() = default;
@@ -72,6 +95,15 @@ class GLProgram {
         void use() const;
         GLuint get() const;
 
+        // Uniform handle resolved once, -1 if the uniform is not active in the program
+        int uniform(const std::string& name) const;
+
+        // Typed setters, the program must be in use. Values equal to the last ones sent are skipped
+        void setInt(int handle, int v);
+        void setFloat(int handle, float v);
+        void setVec2(int handle, float x, float y);
+        void setVec4(int handle, float x, float y, float z, float w);
+
         GLProgram(const GLProgram&) = delete;
         GLProgram& operator=(const GLProgram&) = delete;
 
@@ -80,6 +112,17 @@ class GLProgram {
 
     private:
         static GLuint compile(GLenum type, const char* src);
+        void cacheUniforms();
+        bool changed(int handle, const void* value, size_t size);
+
+        // Active uniform with the last value sent to the driver
+        struct Uniform {
+            GLint location = -1;
+            uint32_t value[4] = {0, 0, 0, 0};
+            bool sent = false;
+        };
 
         GLuint id = 0;
+        std::vector<Uniform> uniforms;
+        std::unordered_map<std::string, int> uniformNames;
 };
\ No newline at end of file
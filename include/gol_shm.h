@@ -0,0 +1,86 @@
+/*
+ * Layout of the shared memory export of the grid (shm.enabled or --shm), for readers in other processes.
+ *
+ * The segment starts with a gol_shm_header, the grid buffers follow at the offsets given by their slot. The simulation
+ * computes each generation in the slot that is not published, then publishes it: a published slot is only written again
+ * two generations later, so a reader has the time of a whole step to go through it in place. Each slot is guarded by a
+ * seqlock: its sequence is odd while it is written, and a read is consistent when the sequence is even and did not change
+ * from gol_shm_read_begin() to gol_shm_read_end(). The writer never waits for the readers.
+ *
+ *     int fd = shm_open("/game_of_life", O_RDONLY, 0);
+ *     struct stat st; fstat(fd, &st);
+ *     const gol_shm_header* h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+ *     uint64_t seq;
+ *     int slot;
+ *     do {
+ *         slot = gol_shm_read_begin(h, &seq);
+ *         if (slot < 0) continue;
+ *         const gol_shm_slot* s = &h->slots[slot];
+ *         const uint64_t* words = gol_shm_words(h, slot);
+ *         ... read s->generation, s->width, s->height and the rows 1 to s->rows - 2 of words ...
+ *     } while (slot < 0 || !gol_shm_read_end(h, slot, seq));
+ *
+ * Results computed from the words must be dropped when gol_shm_read_end() fails. The slot offsets are fixed for the life
+ * of a segment: a change of the slot stride (any resize that changes the buffer size rounded up to pages, smaller grids
+ * and new row lengths included) makes the writer create a new segment of the same name and mark the old one
+ * GOL_SHM_RETIRED, readers then map the name again. Resizes that keep the stride only change the shape of the slots.
+ */
+#ifndef GOL_SHM_H
+#define GOL_SHM_H
+
+#include <stdint.h>
+
+#define GOL_SHM_MAGIC        0x474F4C4752494431ULL  /* "GOLGRID1" */
+#define GOL_SHM_VERSION      1
+#define GOL_SHM_SLOTS        2
+#define GOL_SHM_HEADER_BYTES 4096                   /* the words of the slots start on pages after the header */
+
+enum {
+    GOL_SHM_LIVE = 0,
+    GOL_SHM_RETIRED = 1
+};
+
+/* One grid buffer. Rows hold words_per_row words, bit b of word w is the cell at x = 64 w + b. The first and last rows
+   are padding (dead cells, or the halos of the neighbour stripes in domain mode), cells of row r are at y = r - 1. */
+typedef struct gol_shm_slot {
+    uint64_t seq;               /* odd while the slot is written */
+    uint64_t generation;
+    uint32_t width;             /* cells per row */
+    uint32_t height;            /* rows of cells */
+    uint32_t rows;              /* height + 2 */
+    uint32_t words_per_row;
+    uint64_t offset;            /* bytes from the start of the segment to the first word */
+    uint64_t reserved[3];
+} gol_shm_slot;
+
+typedef struct gol_shm_header {
+    uint64_t magic;             /* GOL_SHM_MAGIC once the segment is set up */
+    uint32_t version;
+    uint32_t state;             /* GOL_SHM_LIVE, or GOL_SHM_RETIRED when replaced by a new segment */
+    uint64_t size;              /* bytes of the segment */
+    uint64_t current;           /* slot of the last published generation */
+    uint64_t reserved[4];
+    gol_shm_slot slots[GOL_SHM_SLOTS];
+} gol_shm_header;
+
+/* Start reading the last published generation: returns its slot and stores its sequence, or -1 while it is rewritten */
+static inline int gol_shm_read_begin(const gol_shm_header* h, uint64_t* seq) {
+    int slot = (int)__atomic_load_n(&h->current, __ATOMIC_ACQUIRE);
+    uint64_t s = __atomic_load_n(&h->slots[slot].seq, __ATOMIC_ACQUIRE);
+    if (s & 1) return -1;
+    *seq = s;
+    return slot;
+}
+
+/* Words of a slot, rows after rows */
+static inline const uint64_t* gol_shm_words(const gol_shm_header* h, int slot) {
+    return (const uint64_t*)((const unsigned char*)h + h->slots[slot].offset);
+}
+
+/* Nonzero when the slot was not written since gol_shm_read_begin(): everything read from it is one generation */
+static inline int gol_shm_read_end(const gol_shm_header* h, int slot, uint64_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&h->slots[slot].seq, __ATOMIC_RELAXED) == seq;
+}
+
+#endif
@@ -1,16 +1,96 @@
 #pragma once
 
 #include "config.hpp"
+#include "sparse_world.hpp"
+#include "arena.hpp"
+#include "workers.hpp"
+#include "domain.hpp"
+#include "philox.hpp"
 
 #include <vector>
 #include <random>
+#include <memory>
+#include <span>
+#include <functional>
 
+// Words per row: cells are left aligned, the dead border on the left and right sides comes from the missing neighbour words
 inline int w_for_w(int N) {
-    int minwords = (N + 63) / 64;
-    int pad = (minwords * 64) - N;
-    return (pad == 0 || pad == 1) ? minwords + 1 : minwords;
+    return (N + 63) / 64;
 }
 
+// Next state of the 64 cells of word m, given the words on its left (l), right (r), top (t) and bottom (b).
+// Only the bit 63 of left words and the bit 0 of right words are used.
+inline uint64_t next_word(uint64_t tl, uint64_t t, uint64_t tr,
+                          uint64_t ml, uint64_t m, uint64_t mr,
+                          uint64_t bl, uint64_t b, uint64_t br,
+                          uint16_t born_rule, uint16_t survive_rule) {
+    // Shifting in each direction to get Moore's neighborhood
+    uint64_t top_left  = (t << 1) | (tl >> 63);
+    uint64_t top_mid   = t;
+    uint64_t top_right = (t >> 1) | (tr << 63);
+
+    uint64_t mid_left  = (m << 1) | (ml >> 63);
+    uint64_t mid_right = (m >> 1) | (mr << 63);
+
+    uint64_t bot_left  = (b << 1) | (bl >> 63);
+    uint64_t bot_mid   = b;
+    uint64_t bot_right = (b >> 1) | (br << 63);
+
+    // Bitwise adder
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    uint64_t c1 = 0, c2 = 0;
+
+    c1 = s0 & top_left; s0 ^= top_left; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & top_mid;  s0 ^= top_mid;  c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & top_right; s0 ^= top_right; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & mid_left; s0 ^= mid_left; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & mid_right; s0 ^= mid_right; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & bot_left; s0 ^= bot_left; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & bot_mid; s0 ^= bot_mid; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+    c1 = s0 & bot_right; s0 ^= bot_right; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
+
+    // Count buffer: 0 to 8 neighboors for each cell of the current word
+    uint64_t count[9];
+    count[0] = ~s3 & ~s2 & ~s1 & ~s0;
+    count[1] = ~s3 & ~s2 & ~s1 & s0;
+    count[2] = ~s3 & ~s2 & s1 & ~s0;
+    count[3] = ~s3 & ~s2 & s1 & s0;
+    count[4] = ~s3 & s2 & ~s1 & ~s0;
+    count[5] = ~s3 & s2 & ~s1 & s0;
+    count[6] = ~s3 & s2 & s1 & ~s0;
+    count[7] = ~s3 & s2 & s1 & s0;
+    count[8] = s3 & ~s2 & ~s1 & ~s0;
+
+    // Set born and survive masks for the word
+    uint64_t born = 0ULL, survive = 0ULL;
+
+    // Compute the born and survive condition given the count buffer and the born and survive rules
+    for (int i = 0; i < 9; ++i) {
+        if (born_rule & (1U << i)) born |= count[i];
+        if (survive_rule & (1U << i)) survive |= count[i];
+    }
+
+    return (~m & born) | (m & survive);
+}
+
+// Bit-sliced 4 bit age counters of 64 cells, one word per plane: reset where cells changed, incremented elsewhere up to 15
+inline void age_word(uint64_t* planes, uint64_t changed) {
+    uint64_t carry = ~(planes[0] & planes[1] & planes[2] & planes[3]);
+    for (int p = 0; p < 4; ++p) {
+        uint64_t a = planes[p];
+        planes[p] = (a ^ carry) & ~changed;
+        carry &= a;
+    }
+}
+
+// Words changed by one step, in the word layout of the grid. Run-length list: a header word per run
+// (words skipped since the end of the previous run << 32 | changed words), followed by the XOR masks of the changed words
+struct ChangeList {
+    uint64_t generation = 0;    // generation produced by the step
+    size_t words = 0;           // number of changed words
+    std::vector<uint64_t> runs;
+};
+
 class Grid {
     public:
         Grid();
@@ -18,38 +98,118 @@ class Grid {
 
         void initSeed();
         void initSize();
+        void initThreads();
         void initRuleset();
+        void initLut();
         void initMask();
 
         void initCheckerGrid();
         void initRandomGrid();
+        void initWorld();
+        void initHeat();
+
+        void initShared(const std::string& name);
+
+        void resize(int gridx, int gridy, bool centered = true);
+        void restore(const std::vector<uint64_t>& words, uint64_t generation);
+        void markAllDirty();
 
         void step();
         
-        void printMask();
         void printCurrent();
 
         std::vector<uint64_t> getGrid();
-        std::vector<uint64_t> getMask();
         const uint32_t* getGrid32Ptr() const;
+        const uint64_t* getGridPtr() const;
+        const uint64_t* getHeatPtr() const;
+
+        uint64_t population() const;
+        uint64_t hash() const;
 
-        int leftpad;
         int rows;
         int words_per_row;
-        int blocksize;
         int gridSeed;
         bool pause = true;
 
+        // Generations since the last initialization of the pattern
+        uint64_t generation = 0;
+
+        // Listeners called after each step and each change of the pattern, not after restore(). They get the words changed
+        // by the step, or nullptr when the whole grid may have changed (new pattern, resize, unbounded world).
+        // Changed words are only collected while at least one listener is registered.
+        void addListener(std::function<void(const ChangeList*)> fn);
+
+        // Dirty tracking: version is bumped on each change of the grid, rowVersion holds the version of the last change of each row.
+        // Consumers keep the last version they have seen and only look at rows with a newer one.
+        uint64_t version = 0;
+        std::vector<uint64_t> rowVersion;
+
+        // Rows holding at least one live cell in the current buffer, kept up to date by step(). Empty rows surrounded by
+        // empty rows are skipped by the kernels, and the renderer only uploads the rows between the first and last live ones.
+        std::vector<uint8_t> rowLive;
+
+        // Position of the grid view in the unbounded world (unbounded mode only)
+        int64_t originX = 0;
+        int64_t originY = 0;
+        std::unique_ptr<SparseWorld> world;
+
+        // Stripe of a decomposed grid (domain mode only): the padding rows hold the boundary rows of the neighbour stripes
+        Domain* domain = nullptr;
+
         Config* cfg = nullptr;
     private:
-        std::mt19937 rng;
-        std::uniform_int_distribution<uint64_t> uniform_dist;
-        std::bernoulli_distribution bernoulli_dist;
-
-        std::vector<uint64_t> mask;
-        std::vector<uint64_t> current;
-        std::vector<uint64_t> next;
-        std::vector<uint64_t> count;
+        // Buffers are slots of the arena, rows are split in bands, one per worker thread
+        GridArena arena;
+        WorkerPool workers;
+        std::vector<int> bandStart;
+
+        // Valid cells of the last word of each row, the only one holding padding bits
+        uint64_t tailMask = ~0ULL;
+
+        // Runs of changed words of one part of the rows: start word, count and masks for each run
+        struct ChangeRuns {
+            std::vector<uint64_t> data;
+            size_t head = 0;
+            uint64_t end = ~0ULL;
+
+            void clear() { data.clear(); end = ~0ULL; }
+            void add(uint64_t index, uint64_t mask) {
+                if (index != end) {
+                    head = data.size();
+                    data.push_back(index);
+                    data.push_back(0);
+                }
+                data.push_back(mask);
+                ++data[head + 1];
+                end = index + 1;
+            }
+        };
+
+        std::vector<std::function<void(const ChangeList*)>> listeners;
+        std::vector<ChangeRuns> partRuns;   // top halo row, one per band, bottom halo row
+        ChangeList changes;
+
+        void notify(const ChangeList* list);
+        void mergeChanges();
+
+        std::span<uint64_t> current;
+        std::span<uint64_t> next;
+        std::vector<uint8_t> nextRowLive;   // rowLive of the next buffer, set for every row it may hold live cells in
+        int currentSlot = 0;                // arena slot of the current buffer
+
+        // Heat map: generations since the last change of each cell, 4 planes per grid word, interleaved word after word
+        std::vector<uint64_t> heat;
+
+        void publishShared();
+        void skipRow(int r);
+        template<bool Heat> void stepRows(int r0, int r1, ChangeRuns* runs);
+        template<bool Heat> void stepRowsLut(int r0, int r1, ChangeRuns* runs);
+        void stepRange(int r0, int r1, ChangeRuns* runs);
+        void stepBands(int r0, int r1);
+        void extractWorld(bool trackHeat = false);
+
+        // Lookup table kernel: next state of the 2x2 center of every 4x4 block of cells, empty with the adder kernel
+        std::vector<uint8_t> lut;
 
         uint16_t born_rule = 0b0000000000000000;
         uint16_t survive_rule = 0b0000000000000000;
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "grid.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Ring buffer of recent generations for rewinding: keyframes at a fixed interval, XOR deltas with the previous
+// generation in between, both run-length encoded. The oldest keyframe groups are dropped to stay under the memory budget.
+// The main thread only copies the grid, or the changed words of a step, encoding is done by a background thread.
+class History {
+    public:
+        History();
+        ~History();
+
+        History(const History&) = delete;
+        History& operator=(const History&) = delete;
+
+        void init(size_t budgetBytes, int keyInterval);
+        void record(const Grid& grid, const ChangeList* changes);
+        bool rewind(Grid& grid);
+
+        size_t frameCount();
+        size_t keyframeCount();
+        size_t memoryBytes();
+        uint64_t oldestGeneration();
+
+    private:
+        // Grid content handed over to the background thread
+        struct Snapshot {
+            uint64_t generation = 0;
+            bool key = false;       // no previous generation to make a delta with
+            bool reset = false;     // new pattern or new size, older frames are dropped
+            bool delta = false;     // runs holds the changes since the previous generation, words is unused
+            std::vector<uint64_t> words;
+            std::vector<uint64_t> runs;
+        };
+
+        // Stored generation, run-length encoded
+        struct Frame {
+            uint64_t generation = 0;
+            bool key = false;
+            std::vector<uint64_t> rle;
+        };
+
+        void loop();
+        void store(Snapshot& snap);
+        void flush();
+        void evict();
+        bool reconstruct(uint64_t generation, std::vector<uint64_t>& out);
+        size_t findFrame(uint64_t generation) const;
+
+        static void encode(const uint64_t* words, size_t size, std::vector<uint64_t>& out);
+        static void decodeXor(const std::vector<uint64_t>& rle, std::vector<uint64_t>& out);
+
+        size_t budget = 64ULL << 20;
+        std::atomic<int> keyInterval = 32;
+
+        // Encoded frames and their size, owned by the background thread while it works
+        std::deque<Frame> frames;
+        size_t bytes = 0;
+        std::vector<uint64_t> last;
+        std::vector<uint64_t> delta;
+        int sinceKey = 0;
+
+        // Hand over queue, full snapshots are dropped instead of blocking the simulation
+        static constexpr size_t maxPending = 8;
+        std::deque<Snapshot> pending;
+        std::vector<std::vector<uint64_t>> spare;
+        bool busy = false;
+        bool quit = false;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::thread worker;
+
+        // Main thread view of the recorded sequence
+        bool recorded = false;
+        bool gap = false;
+        uint64_t lastGeneration = 0;
+        size_t lastSize = 0;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <bit>
+
+// Counter-based random numbers (Philox 4x32 with 10 rounds, Salmon et al. 2011): the output is a pure function of
+// a 128 bit counter and a 64 bit key, so any number of the stream can be drawn on its own, by any thread, in any order.
+struct Philox4x32 {
+    uint32_t c[4];
+
+    static constexpr uint32_t mul0 = 0xD2511F53u;
+    static constexpr uint32_t mul1 = 0xCD9E8D57u;
+    static constexpr uint32_t weyl0 = 0x9E3779B9u;
+    static constexpr uint32_t weyl1 = 0xBB67AE85u;
+
+    Philox4x32(uint64_t counter, uint32_t stream, uint64_t key) {
+        c[0] = (uint32_t)counter;
+        c[1] = (uint32_t)(counter >> 32);
+        c[2] = stream;
+        c[3] = 0;
+        uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+        for (int i = 0; i < 10; ++i) {
+            uint64_t p0 = (uint64_t)mul0 * c[0];
+            uint64_t p1 = (uint64_t)mul1 * c[2];
+            uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+            uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+            c[0] = n0;
+            c[1] = (uint32_t)p1;
+            c[2] = n2;
+            c[3] = (uint32_t)p0;
+            k0 += weyl0;
+            k1 += weyl1;
+        }
+    }
+
+    uint64_t lo() const { return (uint64_t)c[1] << 32 | c[0]; }
+    uint64_t hi() const { return (uint64_t)c[3] << 32 | c[2]; }
+};
+
+// 64 random bits for word 'index' of stream 'stream'
+inline uint64_t philox_word(uint64_t key, uint64_t index, uint32_t stream) {
+    return Philox4x32(index, stream, key).lo();
+}
+
+// 64 independent cells alive with probability p, for word 'index'. The bits of p are consumed from the least
+// significant one: a set bit ORs a random word into the result, a clear bit ANDs it, which compares 64 uniform
+// numbers with p at once. p is rounded to 32 bits and trailing zero bits cost nothing (p = 0.5 is one word).
+inline uint64_t philox_bernoulli(uint64_t key, uint64_t index, double p) {
+    double scaled = p * 4294967296.0 + 0.5;
+    if (scaled < 1.0) return 0ULL;
+    if (scaled >= 4294967296.0) return ~0ULL;
+    uint32_t bits = (uint32_t)scaled;
+    int skip = std::countr_zero(bits);
+    uint64_t acc = 0ULL;
+    for (int i = skip; i < 32; ++i) {
+        uint64_t r = philox_word(key, index, (uint32_t)(i + 1));
+        acc = ((bits >> i) & 1) ? (acc | r) : (acc & r);
+    }
+    return acc;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "grid.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Live cell counts of the grid by square blocks, for drawing zoomed out views without reading every cell.
+// Level k holds one count per 2^k x 2^k block; only the levels from baseLevel to maxLevel are stored.
+class DensityPyramid {
+    public:
+        static constexpr int baseLevel = 3;
+        static constexpr int maxLevel = 7;
+
+        DensityPyramid();
+        ~DensityPyramid();
+
+        void init(const Grid* grid, int gridx, int gridy);
+        void update(int level);
+
+        const std::vector<uint16_t>& getLevel(int level) const;
+        int levelWidth(int level) const;
+        int levelHeight(int level) const;
+
+    private:
+        void updateBase();
+        void updateLevel(int level);
+
+        const Grid* grid = nullptr;
+        int gridx = 0;
+        int gridy = 0;
+
+        // Last grid version folded in the base level
+        uint64_t seenVersion = 0;
+
+        // Counts and dirty block rows of each level, indexed by level - baseLevel
+        std::vector<std::vector<uint16_t>> levels;
+        std::vector<std::vector<uint8_t>> dirty;
+        std::vector<int> widths;
+        std::vector<int> heights;
+};
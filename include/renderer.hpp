@@ -3,6 +3,7 @@
 #include "gl_wrappers.hpp"
 #include "config.hpp"
 #include "grid.hpp"
+#include "pyramid.hpp"
 
 #include <memory>
 
@@ -21,6 +22,9 @@ class Renderer {
         float maxZoom = 100.0f;
 
     private:
+        int selectLevel() const;
+        void updateWindow();
+
         const uint32_t* grid_data;
         std::vector<float> vertices;
 
@@ -36,5 +40,40 @@ class Renderer {
         std::unique_ptr<GLVertexBuffer> vao;
         std::unique_ptr<GLBuffer> vbo;
         std::unique_ptr<GLTextureBuffer> texture;
+        size_t textureBytes = 0;
+
+        // Visible rows and words of the grid plus a margin, the only part uploaded to the texture
+        int winRow0 = 0;
+        int winRows = 0;
+        int winWord0 = 0;
+        int winWords = 0;
+        std::vector<uint64_t> window;
+
+        // Heat map planes of the same window, 4 words per grid word
+        std::unique_ptr<GLTextureBuffer> heatTexture;
+        size_t heatBytes = 0;
+        std::vector<uint64_t> heatWindow;
+
+        // Zoomed out views draw block densities from the pyramid instead of single cells
+        DensityPyramid pyramid;
+        std::unique_ptr<GLTextureBuffer> lodTexture;
+        size_t lodBytes = 0;
+        int lodLevel = 0;
         std::unique_ptr<GLProgram> shaders;
+
+        // Uniform handles of the main program
+        int uPackedGrid = -1;
+        int uLodGrid = -1;
+        int uLodLevel = -1;
+        int uLodWidth = -1;
+        int uWindowSize = -1;
+        int uGridSize = -1;
+        int uWinRow0 = -1;
+        int uWinRows = -1;
+        int uWinWord0 = -1;
+        int uWinWords = -1;
+        int uZoom = -1;
+        int uCamera = -1;
+        int uHeatGrid = -1;
+        int uHeatmap = -1;
 };
\ No newline at end of file
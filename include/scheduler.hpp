@@ -0,0 +1,40 @@
+#pragma once
+
+#include "grid.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+// Simulation rate control, independent of the frame rate: steps due at each frame for a target rate in generations per second.
+// A rate of 0 runs as many steps as fit in the frame budget.
+class Scheduler {
+    public:
+        Scheduler();
+        ~Scheduler();
+
+        void setRate(double gensPerSecond);
+        double getRate() const;
+        double getAchievedRate() const;
+
+        int run(Grid& grid);
+        void stop();
+        double timeToNextStep() const;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        void measure(int steps, clock::time_point now);
+
+        double rate = 0.0;
+        double frameBudget = 1.0 / 60.0;
+
+        // Steps owed since the last frame, at most one is carried when a frame runs out of budget
+        double debt = 0.0;
+        bool running = false;
+        clock::time_point last;
+
+        // Achieved rate measured over windows of half a second
+        clock::time_point windowStart;
+        uint64_t windowSteps = 0;
+        double achieved = 0.0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "config.hpp"
+#include "grid.hpp"
+#include "task_pool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Object found by the pattern search, in its canonical phase and orientation
+struct SearchFind {
+    uint64_t id = 0;            // hash of the canonical phase and orientation
+    int period = 0;
+    int dx = 0, dy = 0;         // displacement per period, dx >= dy >= 0
+    uint64_t population = 0;    // live cells of the canonical phase
+    int width = 0, height = 0;
+    std::string rle;
+    uint64_t count = 0;         // soups ending on this object
+    uint64_t firstSoup = 0;     // lowest soup index giving it
+};
+
+// Headless search of still lifes, oscillators and spaceships: small soups, random or enumerated, are run on tiny grids
+// until the pattern repeats, up to a translation. The repeated pattern is identified by the hash of its bounding box
+// in canonical phase and orientation, and counted in a hash set shared by the workers.
+class Search {
+    public:
+        Search(const Config* cfg);
+        ~Search();
+
+        void run();
+
+    private:
+        // Bounding box of a pattern: rows of w_for_w(width) words, bit b of a word is the cell at x0 + b
+        struct Pattern {
+            int x0 = 0, y0 = 0;
+            int width = 0, height = 0;
+            std::vector<uint64_t> bits;
+
+            bool get(int x, int y) const;
+            uint64_t hash() const;
+        };
+
+        // Findings sharded by id, each shard behind its own lock
+        static constexpr size_t shardCount = 64;
+        struct Shard {
+            std::mutex mtx;
+            std::unordered_map<uint64_t, SearchFind> finds;
+        };
+
+        void seedSoup(Grid& grid, uint64_t soup, std::vector<uint64_t>& words) const;
+        bool extract(const Grid& grid, Pattern& p) const;
+        Pattern transform(const Pattern& p, int sym) const;
+        std::string toRle(const Pattern& p) const;
+        void runSoup(Grid& grid, uint64_t soup, std::vector<uint64_t>& words);
+        void record(SearchFind&& find, const Pattern& canon, uint64_t soup);
+        void write(double seconds);
+
+        const Config* cfg = nullptr;
+        std::string rule;
+        TaskPool pool;
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        // Soups ending dead, reaching the grid border, or without repetition within the step limit
+        std::atomic<uint64_t> dead = 0;
+        std::atomic<uint64_t> escaped = 0;
+        std::atomic<uint64_t> unresolved = 0;
+};
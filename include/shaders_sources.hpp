@@ -17,15 +17,33 @@ static constexpr const char* mainFrag = R"(
     #version 330 core
 
     uniform usamplerBuffer packedGrid;  // plus de layout(binding)
-    uniform int leftpad;
     uniform vec2 windowSize;
     uniform vec2 gridSize;
-    uniform int words_per_row;
+    uniform int winRow0;                // uploaded window: first row, first word and size
+    uniform int winRows;
+    uniform int winWord0;
+    uniform int winWords;
     uniform float zoom;
     uniform vec2 camera;
+    uniform usamplerBuffer lodGrid;     // live cells per 2^lodLevel block
+    uniform int lodLevel;               // 0: cells are drawn one by one
+    uniform int lodWidth;
+    uniform usamplerBuffer heatGrid;    // 4 age planes per word of the window
+    uniform int heatmap;
 
     out vec4 FragColor;
 
+    // Black (cold) to red then yellow (recent change)
+    vec3 heatColor(float t) {
+        return vec3(clamp(2.0 * t, 0.0, 1.0), clamp(2.0 * t - 1.0, 0.0, 1.0) * 0.85, 0.0);
+    }
+
+    uint bitOf(uvec2 word, int bit_index) {
+        return (bit_index < 32)
+            ? ((word.r >> uint(bit_index)) & 1u)
+            : ((word.g >> uint(bit_index - 32)) & 1u);
+    }
+
     void main() {
         float windowAspect = windowSize.x / windowSize.y;
         float gridAspect   = gridSize.x / gridSize.y;
@@ -49,22 +67,46 @@ static constexpr const char* mainFrag = R"(
         if (gx < 0 || gx >= int(gridSize.x) || gy < 0 || gy >= int(gridSize.y))
             discard;
 
+        // Zoomed out: gray level of the block density
+        if (lodLevel > 0) {
+            int blockIndex = (gy >> lodLevel) * lodWidth + (gx >> lodLevel);
+            float density = float(texelFetch(lodGrid, blockIndex).r) / float(1 << (2 * lodLevel));
+            FragColor = vec4(density, density, density, 1.0);
+            return;
+        }
+
         int y = gy + 1;
-        int x = gx + leftpad;
+        int x = gx;
 
         int word_index = x / 64;
         int bit_index  = x % 64;
 
-        // === Index linéaire dans le buffer ===
-        int linearIndex = y * words_per_row + word_index;
+        // Cells out of the uploaded window are not visible, drawn dead
+        int wy = y - winRow0;
+        int wx = word_index - winWord0;
+        if (wy < 0 || wy >= winRows || wx < 0 || wx >= winWords) {
+            FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+            return;
+        }
+
+        // === Index linéaire dans la fenêtre ===
+        int linearIndex = wy * winWords + wx;
 
         // Chaque texel contient deux uint32 (low/high)
         uvec2 word = texelFetch(packedGrid, linearIndex).rg;
 
         // === Extraction du bit vivant ===
-        uint alive = (bit_index < 32)
-            ? ((word.r >> uint(bit_index)) & 1u)
-            : ((word.g >> uint(bit_index - 32)) & 1u);
+        uint alive = bitOf(word, bit_index);
+
+        // Heat map: dead cells colored by the generations since their last change
+        if (heatmap != 0 && alive == 0u) {
+            uint age = 0u;
+            for (int p = 0; p < 4; ++p) {
+                age |= bitOf(texelFetch(heatGrid, linearIndex * 4 + p).rg, bit_index) << uint(p);
+            }
+            FragColor = vec4(heatColor(1.0 - float(age) / 15.0), 1.0);
+            return;
+        }
 
         float val = float(alive);
         FragColor = vec4(val, val, val, 1.0);
@@ -89,3 +131,32 @@ static constexpr const char* consoleFrag = R"(
         FragColor = uColor;
     }
 )";
+static constexpr const char* textVert = R"(
+    #version 330 core
+    layout(location = 0) in vec2 aCorner;   // unit quad corner
+    layout(location = 1) in vec3 aGlyph;    // top left pixel of the glyph, character code
+    uniform vec2 uScreen;
+    out vec2 uv;
+    void main() {
+        vec2 pos = aGlyph.xy + aCorner * 8.0;
+        vec2 ndc = (pos / uScreen) * 2.0 - 1.0;
+        ndc.y = -ndc.y; // Origine en haut
+        gl_Position = vec4(ndc, 0.0, 1.0);
+
+        // Atlas of 16 x 8 glyphs of 8 x 8 pixels
+        int code = int(aGlyph.z);
+        vec2 cell = vec2(code % 16, code / 16);
+        uv = (cell + aCorner) / vec2(16.0, 8.0);
+    }
+)";
+static constexpr const char* textFrag = R"(
+    #version 330 core
+    in vec2 uv;
+    out vec4 FragColor;
+    uniform sampler2D uAtlas;
+    uniform vec4 uColor;
+    void main() {
+        if (texture(uAtlas, uv).r < 0.5) discard;
+        FragColor = uColor;
+    }
+)";
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "config.hpp"
+#include "grid.hpp"
+#include "workers.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPU renderer reproducing the view of the mainFrag shader (zoom, camera, aspect correction) into an RGBA buffer,
+// for frame export without any OpenGL context
+class SoftRenderer {
+    public:
+        SoftRenderer(const Grid* grid, const Config* cfg);
+
+        void resize(int width, int height);
+        void render();
+
+        const std::vector<uint8_t>& getPixels() const;
+        int getWidth() const;
+        int getHeight() const;
+
+        float zoom = 1.0f;
+        float camX = 0.0f;
+        float camY = 0.0f;
+
+    private:
+        void initColumns();
+
+        int width = 0;
+        int height = 0;
+
+        // Per column lookup: word index, bit index and keep mask (0 for columns out of the grid)
+        std::vector<int32_t> colWord;
+        std::vector<uint8_t> colBit;
+        std::vector<uint64_t> colKeep;
+        std::vector<uint32_t> colBase;
+
+        std::vector<uint8_t> pixels;
+        WorkerPool workers;
+
+        const Grid* grid = nullptr;
+        const Config* cfg = nullptr;
+};
+
+// Frame output to a file or to a pipe ('|command'), as raw RGBA or PNG frames
+class FrameWriter {
+    public:
+        FrameWriter();
+        ~FrameWriter();
+
+        FrameWriter(const FrameWriter&) = delete;
+        FrameWriter& operator=(const FrameWriter&) = delete;
+
+        void open(const std::string& target, const std::string& format);
+        void write(const std::vector<uint8_t>& rgba, int width, int height);
+        void close();
+
+    private:
+        void writePng(const std::vector<uint8_t>& rgba, int width, int height);
+        void writeChunk(const char* type, const uint8_t* data, size_t size);
+
+        FILE* out = nullptr;
+        bool isPipe = false;
+        bool png = false;
+        std::vector<uint8_t> scratch;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+// 64x64 cells block, one uint64_t per row, bit b of a row is the cell at x = b
+struct Chunk {
+    uint64_t cells[64];
+    uint64_t next[64];
+    int32_t cx = 0;
+    int32_t cy = 0;
+};
+
+// Pool of chunks allocated by blocks, released chunks are kept in a free list for reuse
+class ChunkPool {
+    public:
+        ChunkPool();
+        ~ChunkPool();
+
+        Chunk* acquire(int32_t cx, int32_t cy);
+        void release(Chunk* chunk);
+        void clear();
+
+        size_t capacity() const;
+
+    private:
+        static constexpr size_t blockChunks = 64;
+
+        std::vector<std::unique_ptr<Chunk[]>> blocks;
+        std::vector<Chunk*> freeList;
+};
+
+// Unbounded world made of bit-packed chunks stored in a hash map keyed by chunk coordinates
+class SparseWorld {
+    public:
+        SparseWorld();
+        ~SparseWorld();
+
+        void clear();
+        void setRules(uint16_t born, uint16_t survive);
+
+        void orWord(int64_t x, int64_t y, uint64_t bits);
+        uint64_t getWord(int64_t x, int64_t y) const;
+
+        void step();
+
+        size_t chunkCount() const;
+        uint64_t population() const;
+
+    private:
+        static uint64_t key(int32_t cx, int32_t cy);
+        Chunk* findChunk(int32_t cx, int32_t cy) const;
+        Chunk* getOrCreate(int32_t cx, int32_t cy);
+
+        struct KeyHash {
+            size_t operator()(uint64_t k) const {
+                k ^= k >> 33; k *= 0xff51afd7ed558ccdULL; k ^= k >> 33;
+                return static_cast<size_t>(k);
+            }
+        };
+
+        std::unordered_map<uint64_t, Chunk*, KeyHash> chunks;
+        ChunkPool pool;
+
+        // One entry lookup cache, rows are read and written word after word
+        mutable uint64_t lastKey = ~0ULL;
+        mutable Chunk* lastChunk = nullptr;
+
+        uint16_t born_rule = 0;
+        uint16_t survive_rule = 0;
+};
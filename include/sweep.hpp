@@ -0,0 +1,46 @@
+#pragma once
+
+#include "config.hpp"
+#include "grid.hpp"
+#include "task_pool.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Summary of one run of a sweep
+struct SweepResult {
+    std::string ruleset;
+    std::string distType;
+    float density = 0.0f;
+    int seed = 0;
+    uint64_t steps = 0;
+    uint64_t population = 0;
+    std::string state;      // dead, still, periodic, unstable (max steps reached) or invalid
+    int period = 0;
+    double ms = 0.0;
+};
+
+// Headless parameter sweep: every combination of the sweep block of the config is run on a work-stealing pool,
+// each worker reusing its grid between runs
+class Sweep {
+    public:
+        Sweep(const Config* cfg);
+        ~Sweep();
+
+        void run();
+
+    private:
+        struct Params {
+            std::string ruleset;
+            std::string distType;
+            float density;
+            int seed;
+        };
+
+        void runOne(Grid& grid, Config& local, const Params& p, SweepResult& res);
+        void write(const std::vector<SweepResult>& results);
+
+        const Config* cfg = nullptr;
+        TaskPool pool;
+};
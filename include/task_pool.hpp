@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Work-stealing pool for independent tasks of uneven length: each thread takes tasks from the back of its own queue,
+// and steals from the front of the other queues when its own is empty.
+class TaskPool {
+    public:
+        TaskPool();
+        ~TaskPool();
+
+        void run(int threads, size_t count, const std::function<void(int worker, size_t task)>& fn);
+
+    private:
+        struct Queue {
+            std::mutex mtx;
+            std::deque<size_t> tasks;
+        };
+
+        bool take(int worker, size_t& task);
+
+        std::vector<std::unique_ptr<Queue>> queues;
+};
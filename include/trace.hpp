@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timed scopes of the hot paths, exported as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Each thread writes its events in its own ring buffer, without lock: the oldest events are overwritten.
+// The macros are only compiled with the GOL_TRACE CMake option, recording is then switched on and off at run time.
+#ifdef GOL_TRACE
+#define GOL_TRACE_JOIN2(a, b) a##b
+#define GOL_TRACE_JOIN(a, b) GOL_TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name) TraceScope GOL_TRACE_JOIN(traceScope, __LINE__)(name)
+#define TRACE_THREAD(name) Trace::nameThread(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
+
+// One complete event: a named scope with its start and duration in nanoseconds since the start of the process
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+};
+
+class Trace {
+    public:
+        static constexpr size_t ringSize = 1 << 16;    // events kept per thread
+
+        static bool compiled();
+        static void start();
+        static void stop();
+        static bool recording();
+        static size_t write(const std::string& path);
+
+        static uint64_t now();
+        static void record(const char* name, uint64_t start);
+        static void nameThread(const std::string& name);
+
+    private:
+        // Written by its thread only. head counts the events ever written. The reader copies the events without lock,
+        // like the reader of a seqlock: it checks head again after copying and drops the events overwritten meanwhile,
+        // and the slot of head, which the thread may be writing
+        struct Ring {
+            std::atomic<uint64_t> head = 0;
+            TraceEvent events[ringSize];
+            int tid = 0;
+            std::string name;
+        };
+
+        static Ring& ring();
+
+        static inline std::atomic<bool> enabled = false;
+        static inline std::atomic<uint64_t> since = 0;  // start of the recording, older events are not exported
+        static inline std::mutex mtx;
+        static inline std::vector<std::unique_ptr<Ring>> rings;
+        static inline thread_local Ring* mine = nullptr;
+        static inline thread_local std::string threadName;
+};
+
+// Records the lifetime of the scope while tracing is on
+class TraceScope {
+    public:
+        TraceScope(const char* name) : name(name), start(Trace::recording() ? Trace::now() : 0) {}
+        ~TraceScope() { if (start) Trace::record(name, start); }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t start;
+};
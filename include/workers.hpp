@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+// Fixed set of persistent worker threads, each one always runs the same band index.
+// The calling thread takes band 0, so a pool of size 1 runs everything inline without any thread.
+class WorkerPool {
+    public:
+        WorkerPool();
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void init(int n);
+        void run(const std::function<void(int)>& fn);
+        int size() const;
+
+    private:
+        void loop(int index, uint64_t seen);
+        void stop();
+
+        std::vector<std::thread> threads;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        const std::function<void(int)>* job = nullptr;
+        uint64_t generation = 0;
+        int pending = 0;
+        int count = 1;
+        bool stopping = false;
+};
@@ -7,6 +7,35 @@
 #include <cstdlib>
 #include <vector>
 #include <format>
+#include <chrono>
+#include <charconv>
+
+// Command line options, they take priority over the config file
+static constexpr const char* usage =
+    "Usage: game_of_life [options]\n"
+    "  --config <path>   config file (default: config.jsonc, created if missing)\n"
+    "  --grid <W>x<H>    grid size\n"
+    "  --rule <rule>     ruleset, e.g. B3S23\n"
+    "  --seed <n>        seed of the random grid\n"
+    "  --threads <n>     worker threads (0: all hardware threads)\n"
+    "  --steps <n>       run n generations without window, print a summary and exit\n"
+    "                    (also the step count of --benchmark and of domain runs)\n"
+    "  --benchmark       time every step kernel and exit\n"
+    "  --rank <n>        run the stripe of rank n of a domain decomposition\n"
+    "  --search          run the pattern search and exit\n"
+    "  --shm <name>      export the grid in the POSIX shared memory /<name> (gol_shm.h)\n"
+    "  --help            show this help\n";
+
+// Parse a whole string as a number
+template<typename T>
+static T parseNumber(const std::string& option, const std::string& s) {
+    T value{};
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || ptr != s.data() + s.size()) {
+        throw std::runtime_error("[Fatal] Bad value for " + option + ": " + s);
+    }
+    return value;
+}
 
 Application::Application() {
 
@@ -16,8 +45,53 @@ Application::~Application() {
     
 }
 
-void Application::run() {
+// Entry point: the mode is chosen by the config and the command line, only the last one opens a window
+void Application::run(int argc, char** argv) {
+    args.assign(argv + 1, argv + argc);
+    if (std::find(args.begin(), args.end(), "--help") != args.end() || std::find(args.begin(), args.end(), "-h") != args.end()) {
+        std::cout << usage;
+        return;
+    }
+
     loadConfig();
+    if (cfg->benchmark) {
+        Benchmark bench(cfg.get());
+        std::cout << std::format("[Info] Kernel benchmark on a {}x{} grid\n", cfg->gridx, cfg->gridy);
+        std::cout << Benchmark::report(bench.run(cfg->benchSteps));
+        return;
+    }
+    if (cfg->sweep) {
+        Sweep sweep(cfg.get());
+        sweep.run();
+        return;
+    }
+    if (cfg->search) {
+        Search search(cfg.get());
+        search.run();
+        return;
+    }
+    if (cfg->domain) {
+        if (cfg->unbounded) {
+            std::cout << "[Config Warning] unbounded world not available with domain decomposition. Moved back to a bounded grid.\n";
+            cfg->unbounded = false;
+        }
+        domain = std::make_unique<Domain>(cfg.get());
+        domain->initStripe();
+        initGrid();
+        runDomain();
+        return;
+    }
+    if (cfg->headless) {
+        initGrid();
+        runHeadless();
+        return;
+    }
+    if (batchSteps > 0) {
+        initGrid();
+        runBatch();
+        return;
+    }
+    cfg->printAllParams();
     initWindow();
     initGlad();
     initGrid();
@@ -94,16 +168,9 @@ void Application::key_callback(GLFWwindow* window, int key, [[maybe_unused]]int
     Application* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
     glfwMakeContextCurrent(window);
     if (app) {
-        // Pause/resume condition. vsync is activated when paused to limit useless framerate
+        // Pause/resume condition. The main loop sleeps on events while paused
         if (key == GLFW_KEY_SPACE && action == GLFW_PRESS && !app->console->visible) {
             app->grid->pause = !app->grid->pause;
-            if (app->grid->pause) {
-                glfwSwapInterval(1);
-            } else {
-                if (!(app->cfg->vsync)) {
-                    glfwSwapInterval(0);
-                }
-            }
         }
 
         // If the simulation is paused, right arrow key press do one simulation step, like a trigger.
@@ -111,6 +178,13 @@ void Application::key_callback(GLFWwindow* window, int key, [[maybe_unused]]int
             app->grid->step();
         }
 
+        // If the simulation is paused, left arrow key press goes back one generation when it is in the history
+        if (app->grid->pause && key == GLFW_KEY_LEFT && action == GLFW_PRESS && !app->console->visible) {
+            if (!app->history || !app->history->rewind(*app->grid)) {
+                app->console->log("No earlier generation in history");
+            }
+        }
+
         // Show/hide console condition : it juste changes the visible bool in Console class to not itself
         if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
             app->console->visible = !app->console->visible;
@@ -253,9 +327,13 @@ void Application::cursor_position_callback(GLFWwindow* window, double posX, doub
 // Initial config loader : Loads the Config class, read the config.jsonc file or create it if not present and print param in console
 // If width and height are below 800 and 600 respectively, send a warning message and move back those values to minimum required
 void Application::loadConfig() {
+    std::string path = "config.jsonc";
+    auto it = std::find(args.begin(), args.end(), "--config");
+    if (it != args.end() && it + 1 != args.end()) path = *(it + 1);
+
     cfg = std::make_unique<Config>();
-    cfg->initConfig("config.jsonc");
-    cfg->printAllParams();
+    cfg->initConfig(path);
+    applyArgs();
     if (cfg->width < 800) {
         std::cout << "[Config Warning] minimum allowed width is 800. Moved back to this value.\n";
         cfg->width = 800;
@@ -266,6 +344,56 @@ void Application::loadConfig() {
     }
 }
 
+// Override the config with the command line options
+void Application::applyArgs() {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        auto value = [&]() -> const std::string& {
+            if (i + 1 >= args.size()) throw std::runtime_error("[Fatal] Missing value after " + opt);
+            return args[++i];
+        };
+
+        if (opt == "--config") {
+            value();
+        } else if (opt == "--grid") {
+            const std::string& v = value();
+            size_t x = v.find('x');
+            if (x == std::string::npos) throw std::runtime_error("[Fatal] Bad value for --grid: " + v + " (expected WxH)");
+            cfg->gridx = parseNumber<int>(opt, v.substr(0, x));
+            cfg->gridy = parseNumber<int>(opt, v.substr(x + 1));
+            if (cfg->gridx < 1 || cfg->gridy < 1) throw std::runtime_error("[Fatal] Bad value for --grid: " + v);
+        } else if (opt == "--rule") {
+            const std::string& v = value();
+            auto [ok, msg] = cfg->parseRuleset(v);
+            if (!ok) throw std::runtime_error("[Fatal] Bad value for --rule: " + v);
+            cfg->rulestr = v;
+        } else if (opt == "--seed") {
+            cfg->seed = parseNumber<int>(opt, value());
+            cfg->randomSeed = false;
+        } else if (opt == "--threads") {
+            cfg->threads = parseNumber<int>(opt, value());
+        } else if (opt == "--steps") {
+            const std::string& v = value();
+            batchSteps = parseNumber<int>(opt, v);
+            if (batchSteps < 1) throw std::runtime_error("[Fatal] Bad value for --steps: " + v + " (expected a positive count)");
+            cfg->benchSteps = batchSteps;
+            cfg->domainSteps = batchSteps;
+        } else if (opt == "--benchmark") {
+            cfg->benchmark = true;
+        } else if (opt == "--search") {
+            cfg->search = true;
+        } else if (opt == "--shm") {
+            cfg->shmName = value();
+            cfg->shm = true;
+        } else if (opt == "--rank") {
+            cfg->domainRank = parseNumber<int>(opt, value());
+            cfg->domain = true;
+        } else {
+            throw std::runtime_error("[Fatal] Unknown option: " + opt + " (--help for the list)");
+        }
+    }
+}
+
 // Window class loader with some glfw setup (vsync, callbacks, ...)
 void Application::initWindow() {
     window = std::make_unique<Window>(cfg->width, cfg->height, title);
@@ -280,7 +408,8 @@ void Application::initWindow() {
     glfwSetScrollCallback(window->get(), scroll_callback);
     glfwSetCursorPosCallback(window->get(), cursor_position_callback);
     
-    if (cfg->vsync || (cfg->freeze_at_start && !cfg->vsync)) {
+    // The swap interval is only set here, the simulation rate is controlled by the scheduler
+    if (cfg->vsync) {
         glfwSwapInterval(1); // Vsync ON
     } else { 
         glfwSwapInterval(0); // Vsync OFF
@@ -311,16 +440,30 @@ void Application::initGrid() {
     grid = std::make_unique<Grid>();
     if (!grid) throw std::runtime_error("[Runtime Error] Cannot initialize grid");
     grid->cfg = cfg.get();
+    grid->domain = domain.get();
     grid->pause = cfg->freeze_at_start;
     grid->initSeed();
     grid->initRuleset();
+    // Ranks of a decomposed grid export their own stripe
+    if (cfg->shm) grid->initShared(domain ? std::format("{}_{}", cfg->shmName, cfg->domainRank) : cfg->shmName);
     grid->initSize();
     grid->initMask();
+
+    // Every step and every new pattern is recorded, no history for headless runs
+    if (cfg->history && !cfg->headless && !domain && batchSteps == 0) {
+        history = std::make_unique<History>();
+        history->init((size_t)cfg->historyMemory << 20, cfg->historyKeyframes);
+        grid->addListener([this](const ChangeList* changes) { history->record(*grid, changes); });
+    }
+
     if (cfg->checker == true) {
         grid->initCheckerGrid();
     } else {
         grid->initRandomGrid();
     }
+
+    scheduler = std::make_unique<Scheduler>();
+    scheduler->setRate(cfg->speed);
 }
 
 // Renderer loader
@@ -332,7 +475,7 @@ void Application::initRender() {
 
 // Console loader
 void Application::initConsole() {
-    console = std::make_unique<Console>(cfg.get(), window.get(), grid.get(), renderer.get());
+    console = std::make_unique<Console>(cfg.get(), window.get(), grid.get(), renderer.get(), scheduler.get(), history.get());
     if (!console) throw std::runtime_error("[Runtime Error] Cannot initialize console");
     console->initConsole();
 }
@@ -345,21 +488,58 @@ void Application::mainLoop() {
     double fpsTimer = lastTime;
     double fps = 0.0;
     int nbFrames = 0;
+    double nextReloadCheck = lastTime + reloadInterval;
+    TRACE_THREAD("main");
 
     while (!glfwWindowShouldClose(window->get())) {
+        // Simulation steps due for this frame if not paused
+        if (!grid->pause) {
+            scheduler->run(*grid);
+        } else {
+            scheduler->stop();
+        }
+
         // Main rendering (the simulation grid)
         renderer->render();
 
         // Console rendering on top of the grid
         console->draw();
         
-        glfwSwapBuffers(window->get());
-        
-        glfwPollEvents();
-        
-        // Solving the next simulation step if not paused
-        if (!grid->pause) {
-            grid->step();
+        {
+            TRACE_SCOPE("swap buffers");
+            glfwSwapBuffers(window->get());
+        }
+
+        // Advance the console tasks by one slice
+        console->update();
+
+        // Sleep until the next event, the next scheduled step or the next console task wake up, instead of spinning.
+        // A negative timeout means that only events can bring new work
+        double now = glfwGetTime();
+        double timeout = grid->pause ? -1.0 : scheduler->timeToNextStep();
+        if (console->hasTask()) {
+            double wait = std::max(0.0, console->nextWakeTime() - now);
+            timeout = (timeout < 0.0) ? wait : std::min(timeout, wait);
+        }
+        if (cfg->hotReload) {
+            double wait = std::max(0.0, nextReloadCheck - now);
+            timeout = (timeout < 0.0) ? wait : std::min(timeout, wait);
+        }
+        {
+            TRACE_SCOPE("events");
+            if (timeout < 0.0) {
+                glfwWaitEvents();
+            } else if (timeout > 0.0) {
+                glfwWaitEventsTimeout(timeout);
+            } else {
+                glfwPollEvents();
+            }
+        }
+
+        // Watch 'config.jsonc' and apply its changed keys
+        if (cfg->hotReload && glfwGetTime() >= nextReloadCheck) {
+            nextReloadCheck = glfwGetTime() + reloadInterval;
+            if (cfg->changedOnDisk()) console->reloadConfig();
         }
 
         // fps counter and display
@@ -368,7 +548,7 @@ void Application::mainLoop() {
             nbFrames++;
             if (currentTime - fpsTimer >= 0.25) {
                 fps = nbFrames / (currentTime - fpsTimer);
-                title = "GOL - FPS: " + std::format("{:.2f}", fps);
+                title = "GOL - FPS: " + std::format("{:.2f}", fps) + " - gens/s: " + std::format("{:.1f}", scheduler->getAchievedRate());
                 glfwSetWindowTitle(window->get(), title.c_str());
                 nbFrames = 0;
                 fpsTimer = currentTime;
@@ -378,4 +558,77 @@ void Application::mainLoop() {
     }
 
     glfwTerminate();
-}
\ No newline at end of file
+}
+
+// Headless loop: frames are rendered on CPU and written to a file or a pipe, no window nor OpenGL context needed
+void Application::runHeadless() {
+    SoftRenderer soft(grid.get(), cfg.get());
+    soft.resize(cfg->exportWidth, cfg->exportHeight);
+
+    // Zoom and camera of the view, clamped like the mouse controls of the window
+    if (cfg->exportCamera.size() != 2) {
+        std::cout << "[Config Warning] export.camera expects [x, y]. Moved back to [0, 0].\n";
+        cfg->exportCamera = {0.0f, 0.0f};
+    }
+    float maxZoom = 100.0f * std::max((float)cfg->gridx / (float)cfg->exportWidth, (float)cfg->gridy / (float)cfg->exportHeight);
+    soft.zoom = std::clamp(cfg->exportZoom, 1.0f, std::max(1.0f, maxZoom));
+    // The camera y of the shader is counted from the bottom of the grid, export.camera from its top row
+    float visibleWidth  = cfg->gridx / soft.zoom;
+    float visibleHeight = cfg->gridy / soft.zoom;
+    soft.camX = std::clamp(cfg->exportCamera[0], 0.0f, cfg->gridx - visibleWidth);
+    soft.camY = std::clamp(cfg->gridy - visibleHeight - cfg->exportCamera[1], 0.0f, cfg->gridy - visibleHeight);
+
+    FrameWriter writer;
+    writer.open(cfg->exportOutput, cfg->exportFormat);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < cfg->exportFrames; ++f) {
+        soft.render();
+        writer.write(soft.getPixels(), soft.getWidth(), soft.getHeight());
+        for (int s = 0; s < cfg->exportSteps; ++s) {
+            grid->step();
+        }
+    }
+    writer.close();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << std::format("[Info] {} frames exported in {:.2f} s ({:.1f} frames/s)\n",
+        cfg->exportFrames, elapsed, cfg->exportFrames / elapsed);
+}
+
+// Domain loop: this process computes its stripe of the grid, exchanging halos with the neighbour ranks at each step
+void Application::runDomain() {
+    domain->connect(grid->words_per_row);
+    std::cerr << std::format("[Info] Rank {} of {}: rows {} to {} of the grid\n",
+        domain->rank, domain->ranks, domain->firstRow, domain->firstRow + domain->stripeRows - 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < cfg->domainSteps; ++s) {
+        grid->step();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << std::format("[Info] Rank {}: {} steps in {:.2f} s, {:.3f} s waiting for halos\n",
+        domain->rank, cfg->domainSteps, elapsed, domain->waitTime);
+
+    // Every rank takes part in the sum, rank 0 reports it
+    uint64_t population = domain->sum(grid->population());
+    if (domain->rank == 0) {
+        std::cerr << std::format("[Info] Population after {} steps: {} ({:.1f} gens/s)\n",
+            cfg->domainSteps, population, cfg->domainSteps / elapsed);
+    }
+}
+
+// Batch run: the given number of generations as fast as possible, then a summary to compare runs
+void Application::runBatch() {
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < batchSteps; ++s) {
+        grid->step();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::format("[Info] {} steps of {} on a {}x{} grid in {:.3f} s ({:.3e} cells/s)\n",
+        batchSteps, cfg->rulestr, cfg->gridx, cfg->gridy, elapsed, (double)cfg->gridx * cfg->gridy * batchSteps / elapsed);
+    std::cout << std::format("[Info] generation {}, population {}, hash {:016x}\n",
+        grid->generation, grid->population(), grid->hash());
+}
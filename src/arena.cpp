@@ -0,0 +1,169 @@
+#include "arena.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+GridArena::GridArena() {
+
+}
+
+GridArena::~GridArena() {
+    release();
+}
+
+// Get room for the given number of slots of words each, the current block is kept if large enough
+void GridArena::reserve(size_t words, int slots) {
+    size_t bytes = words * sizeof(uint64_t);
+    bool wantHuge = bytes >= hugePageSize && shmName.empty();
+    size_t align = wantHuge ? hugePageSize : (shmName.empty() ? 64 : 4096);
+    size_t stride = round_up(bytes, align);
+    size_t total = stride * slots;
+
+    if (!shmName.empty()) {
+        // The offsets of the slots are part of the header, a new stride needs a new segment
+        if (slots > GOL_SHM_SLOTS) throw std::runtime_error("[Fatal] Too many slots for the shared memory export");
+        if (stride != slotStride || !header) createShared(stride);
+    } else if (total > capacity || (wantHuge && !huge)) {
+        release();
+        if (total == 0) return;
+#ifdef _WIN32
+        base = static_cast<uint64_t*>(_aligned_malloc(total, align));
+#else
+        base = static_cast<uint64_t*>(std::aligned_alloc(align, total));
+#endif
+        if (!base) throw std::bad_alloc();
+        capacity = total;
+        huge = wantHuge;
+#ifdef __linux__
+        // Transparent huge pages cut TLB misses when sweeping multi-GB grids
+        if (huge) madvise(base, total, MADV_HUGEPAGE);
+#endif
+    }
+
+    slotStride = stride;
+    slotWords = words;
+    slotCount = slots;
+}
+
+// View on one of the slots
+std::span<uint64_t> GridArena::slot(int i) const {
+    if (i < 0 || i >= slotCount) return {};
+    return std::span<uint64_t>(base + (slotStride / sizeof(uint64_t)) * i, slotWords);
+}
+
+// Size of the allocated block in bytes
+size_t GridArena::capacityBytes() const {
+    return capacity;
+}
+
+// Is the block aligned on and advised for huge pages
+bool GridArena::hugePages() const {
+    return huge;
+}
+
+// Back the slots by the shared memory segment of the given name from the next reserve()
+void GridArena::share(const std::string& name) {
+#ifdef _WIN32
+    (void)name;
+    throw std::runtime_error("[Fatal] The shared memory export needs POSIX shared memory");
+#else
+    release();
+    shmName = "/" + name;
+#endif
+}
+
+// Create the segment of the slots: header, then the slots on page boundaries. A previous segment of the same name is
+// marked retired for its readers and replaced. The slots are marked as written until their first publish()
+void GridArena::createShared(size_t stride) {
+#ifdef _WIN32
+    (void)stride;
+#else
+    release();
+    size_t bytes = GOL_SHM_HEADER_BYTES + stride * GOL_SHM_SLOTS;
+    shm_unlink(shmName.c_str());
+    int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("[Fatal] Cannot create shared memory " + shmName);
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("[Fatal] Cannot map shared memory " + shmName);
+
+    // Zero filled by ftruncate
+    header = static_cast<gol_shm_header*>(p);
+    mapBytes = bytes;
+    base = reinterpret_cast<uint64_t*>(static_cast<unsigned char*>(p) + GOL_SHM_HEADER_BYTES);
+    capacity = bytes - GOL_SHM_HEADER_BYTES;
+    header->version = GOL_SHM_VERSION;
+    header->state = GOL_SHM_LIVE;
+    header->size = bytes;
+    for (int i = 0; i < GOL_SHM_SLOTS; ++i) {
+        header->slots[i].seq = 1;
+        header->slots[i].offset = GOL_SHM_HEADER_BYTES + stride * i;
+    }
+    std::atomic_ref<uint64_t>(header->magic).store(GOL_SHM_MAGIC, std::memory_order_release);
+#endif
+}
+
+// Shared mode: the slot is about to be written, readers of it will retry
+void GridArena::beginWrite(int slot) {
+    if (!header) return;
+    std::atomic_ref<uint64_t> seq(header->slots[slot].seq);
+    uint64_t s = seq.load(std::memory_order_relaxed);
+    if (s & 1) return;
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Shared mode: the slot holds a complete generation, it becomes the one readers start from
+void GridArena::publish(int slot, uint64_t generation, int width, int height, int rows, int wordsPerRow) {
+    if (!header) return;
+    beginWrite(slot);
+    gol_shm_slot& s = header->slots[slot];
+    s.generation = generation;
+    s.width = (uint32_t)width;
+    s.height = (uint32_t)height;
+    s.rows = (uint32_t)rows;
+    s.words_per_row = (uint32_t)wordsPerRow;
+    std::atomic_ref<uint64_t> seq(s.seq);
+    seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    std::atomic_ref<uint64_t>(header->current).store((uint64_t)slot, std::memory_order_release);
+}
+
+// Free the block
+void GridArena::release() {
+#ifndef _WIN32
+    // The readers keep their mapping of a released segment, they are told to map the name again
+    if (header) {
+        std::atomic_ref<uint32_t>(header->state).store(GOL_SHM_RETIRED, std::memory_order_release);
+        munmap(header, mapBytes);
+        shm_unlink(shmName.c_str());
+        header = nullptr;
+        mapBytes = 0;
+        base = nullptr;
+    }
+#endif
+    if (base) {
+#ifdef _WIN32
+        _aligned_free(base);
+#else
+        std::free(base);
+#endif
+    }
+    base = nullptr;
+    capacity = 0;
+    huge = false;
+}
@@ -0,0 +1,219 @@
+#include "bench.hpp"
+#include "grid.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <format>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < PerfCounts::Count; ++i) fds[i] = -1;
+#ifdef __linux__
+    // Same order as PerfCounts::Counter. User space only, allowed with the default perf_event_paranoid setting
+    static const struct { uint32_t type; uint64_t config; } events[PerfCounts::Count] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+    for (int i = 0; i < PerfCounts::Count; ++i) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[i] < 0 && error.empty()) error = std::string("perf_event_open: ") + std::strerror(errno);
+    }
+#else
+    error = "hardware counters are only read on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int i = 0; i < PerfCounts::Count; ++i) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+#endif
+}
+
+// Read one counter, false when it is not open
+bool PerfCounters::read(int i, Reading& r) const {
+#ifdef __linux__
+    if (fds[i] < 0) return false;
+    uint64_t data[3];
+    if (::read(fds[i], data, sizeof(data)) != (ssize_t)sizeof(data)) return false;
+    r = {data[0], data[1], data[2]};
+    return true;
+#else
+    (void)i;
+    (void)r;
+    return false;
+#endif
+}
+
+// Start of the measured section
+void PerfCounters::start() {
+    for (int i = 0; i < PerfCounts::Count; ++i) {
+        begin[i] = {};
+        read(i, begin[i]);
+    }
+}
+
+// Counts since start(), scaled up when the kernel multiplexed a counter with others
+PerfCounts PerfCounters::stop() {
+    PerfCounts counts;
+    counts.error = error;
+    for (int i = 0; i < PerfCounts::Count; ++i) {
+        Reading end;
+        if (!read(i, end)) continue;
+        uint64_t running = end.running - begin[i].running;
+        uint64_t enabled = end.enabled - begin[i].enabled;
+        if (running == 0) {
+            if (counts.error.empty()) counts.error = "counters never scheduled on the PMU";
+            continue;
+        }
+        counts.values[i] = (uint64_t)((double)(end.value - begin[i].value) * enabled / running);
+        counts.available[i] = true;
+    }
+    return counts;
+}
+
+Benchmark::Benchmark(const Config* cfg) {
+    this->cfg = cfg;
+}
+
+Benchmark::~Benchmark() {
+
+}
+
+// Names of the step kernels, as in grid.kernel
+const std::vector<std::string>& Benchmark::kernels() {
+    static const std::vector<std::string> names = {"adder", "lut"};
+    return names;
+}
+
+// Private grid of the run, seeded the same way for every kernel
+BenchRun::BenchRun(const Config* cfg, const std::string& kernel, int steps) : local(*cfg), kernel(kernel), steps(steps) {
+    local.kernel = kernel;
+    local.unbounded = false;
+    local.heatmap = false;
+    local.randomSeed = false;
+
+    grid.cfg = &local;
+    grid.initSeed();
+    grid.initRuleset();
+    grid.initSize();
+    grid.initMask();
+    grid.initRandomGrid();
+
+    for (int i = 0; i < PerfCounts::Count; ++i) counts.available[i] = true;
+}
+
+BenchRun::~BenchRun() {
+
+}
+
+// Run steps for about budget seconds, at least one. True once every step is done
+bool BenchRun::advance(double budget) {
+    perf.start();
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (done < steps) {
+        grid.step();
+        ++done;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= budget) break;
+    }
+    PerfCounts chunk = perf.stop();
+    seconds += elapsed;
+
+    // A counter is only reported when every chunk read it
+    for (int i = 0; i < PerfCounts::Count; ++i) {
+        counts.values[i] += chunk.values[i];
+        counts.available[i] = counts.available[i] && chunk.available[i];
+    }
+    if (counts.error.empty()) counts.error = chunk.error;
+    return done >= steps;
+}
+
+int BenchRun::stepsDone() const {
+    return done;
+}
+
+// Timing and counters of the steps done
+BenchResult BenchRun::result() const {
+    BenchResult res;
+    res.kernel = kernel;
+    res.steps = done;
+    res.cells = (uint64_t)local.gridx * local.gridy;
+    res.seconds = seconds;
+    res.cellsPerSecond = (seconds > 0.0) ? (double)res.cells * done / seconds : 0.0;
+    res.hash = grid.hash();
+    res.counts = counts;
+    return res;
+}
+
+// Time one kernel in a single run
+BenchResult Benchmark::runKernel(const std::string& kernel, int steps) {
+    BenchRun run(cfg, kernel, steps);
+    while (!run.advance(HUGE_VAL)) {}
+    return run.result();
+}
+
+// Time every kernel
+std::vector<BenchResult> Benchmark::run(int steps) {
+    std::vector<BenchResult> results;
+    for (const auto& k : kernels()) {
+        results.push_back(runKernel(k, steps));
+    }
+    return results;
+}
+
+// One line per kernel with its speed relative to the first one, then its hardware counters per cell when available:
+// IPC, cycles, memory traffic estimated from the last level cache misses (64 byte lines), L1 and branch misses.
+// A warning when the kernels disagree
+std::string Benchmark::report(const std::vector<BenchResult>& results) {
+    std::string out;
+    std::string missing;
+    for (const auto& r : results) {
+        double ratio = (results[0].seconds > 0.0) ? results[0].seconds / r.seconds : 0.0;
+        out += std::format("{:<6}: {} steps in {:.3f} s, {:.3e} cells/s (x{:.2f})\n",
+            r.kernel, r.steps, r.seconds, r.cellsPerSecond, ratio);
+
+        const PerfCounts& c = r.counts;
+        double cells = (double)r.cells * r.steps;
+        std::string line;
+        auto add = [&](const std::string& s) { line += (line.empty() ? "" : ", ") + s; };
+        if (c.available[PerfCounts::Cycles] && c.available[PerfCounts::Instructions] && c.values[PerfCounts::Cycles]) {
+            add(std::format("IPC {:.2f}", (double)c.values[PerfCounts::Instructions] / c.values[PerfCounts::Cycles]));
+        }
+        if (cells > 0.0) {
+            if (c.available[PerfCounts::Cycles]) add(std::format("{:.3f} cycles/cell", c.values[PerfCounts::Cycles] / cells));
+            if (c.available[PerfCounts::LLCMisses]) add(std::format("{:.3f} bytes/cell", c.values[PerfCounts::LLCMisses] * 64.0 / cells));
+            if (c.available[PerfCounts::L1Misses]) add(std::format("{:.2e} L1 misses/cell", c.values[PerfCounts::L1Misses] / cells));
+            if (c.available[PerfCounts::BranchMisses]) add(std::format("{:.2e} branch misses/cell", c.values[PerfCounts::BranchMisses] / cells));
+        }
+        if (!line.empty()) out += "        " + line + "\n";
+        if (!c.error.empty()) missing = c.error;
+    }
+    if (!missing.empty()) out += "[Bench Warning] hardware counters unavailable or partial (" + missing + ")\n";
+    for (const auto& r : results) {
+        if (r.hash != results[0].hash) {
+            out += std::format("[Bench Error] kernel {} does not give the same grid as {}\n", r.kernel, results[0].kernel);
+        }
+    }
+    return out;
+}
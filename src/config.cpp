@@ -4,9 +4,160 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cctype>
+#include <cmath>
 #include <fstream>
 #include <filesystem>
+#include <format>
 #include <bitset>
+#include <variant>
+#include <limits>
+#include <algorithm>
+
+// Typed description of a config key: its place in the file, the member holding it, the accepted values and its help line.
+// Keys not live are only read at startup, a change on disk needs a restart
+struct ConfigKey {
+    using Field = std::variant<bool Config::*, int Config::*, float Config::*, double Config::*, std::string Config::*,
+                               std::vector<std::string> Config::*, std::vector<float> Config::*, std::vector<int> Config::*>;
+    const char* section;
+    const char* name;
+    Field field;
+    const char* help;
+    bool live = false;
+    double min = -HUGE_VAL;
+    double max = HUGE_VAL;
+    std::vector<std::string> choices = {};
+};
+
+// Config schema, in the order of the file. Defaults are the member initializers of Config
+static const std::vector<ConfigKey>& schema() {
+    static const std::vector<ConfigKey> keys = {
+        {"debug", "checker", &Config::checker, "checkerboard grid initialization", true},
+        {"debug", "showfps", &Config::showfps, "fps counter in window bar", true},
+        {"debug", "hot_reload", &Config::hotReload, "apply the changes of this file while running", true},
+        {"display", "vsync", &Config::vsync, "vertical synchronization with the screen", true},
+        {"display", "freeze_at_start", &Config::freeze_at_start, "paused simulation at start"},
+        {"display", "heatmap", &Config::heatmap, "dead cells colored by the time since their last change", true},
+        {"grid", "gridx", &Config::gridx, "grid width in cells", true, 1},
+        {"grid", "gridy", &Config::gridy, "grid height in cells", true, 1},
+        {"grid", "unbounded", &Config::unbounded, "unbounded world, the grid is a view on it"},
+        {"grid", "threads", &Config::threads, "worker threads for the simulation (0: all hardware threads)", true, 0},
+        {"grid", "kernel", &Config::kernel, "step kernel, 'adder' (bit-sliced adder) or 'lut' (lookup table of 4x4 blocks)", true, -HUGE_VAL, HUGE_VAL, {"adder", "lut"}},
+        {"window", "width", &Config::width, "window width in pixels (800 minimum)", true, 800},
+        {"window", "height", &Config::height, "window height in pixels (600 minimum)", true, 600},
+        {"game", "ruleset", &Config::rulestr, "birth and survival rule, e.g. 'B3S23'", true},
+        {"game", "random_seed", &Config::randomSeed, "new random seed at each generation of the grid", true},
+        {"game", "seed", &Config::seed, "seed of the random grid", true},
+        {"game", "dist_type", &Config::distType, "random grid distribution, 'uniform' or 'bernoulli'", true, -HUGE_VAL, HUGE_VAL, {"uniform", "bernoulli"}},
+        {"game", "density", &Config::density, "live cell probability of the 'bernoulli' distribution", true, 0.0, 1.0},
+        {"game", "speed", &Config::speed, "simulation rate in generations per second (0: as fast as possible)", true, 0.0},
+        {"history", "enabled", &Config::history, "record recent generations to step back with the left arrow key"},
+        {"history", "memory_mb", &Config::historyMemory, "memory budget of the history, oldest generations are dropped beyond it", true, 1},
+        {"history", "keyframe_interval", &Config::historyKeyframes, "full generation stored every n generations, deltas in between", true, 1},
+        {"sweep", "enabled", &Config::sweep, "headless runs of every combination of sweep.ruleset, dist_type, density and seed, then exit"},
+        {"sweep", "ruleset", &Config::sweepRulesets, "rulesets of the sweep"},
+        {"sweep", "dist_type", &Config::sweepDists, "distributions of the sweep"},
+        {"sweep", "density", &Config::sweepDensities, "densities of the sweep"},
+        {"sweep", "seed", &Config::sweepSeeds, "seeds of the sweep"},
+        {"sweep", "max_steps", &Config::sweepSteps, "steps before a run is reported as unstable, runs stop earlier on a cycle of period_max or less", false, 1},
+        {"sweep", "period_max", &Config::sweepPeriod, "longest detected cycle", false, 1},
+        {"sweep", "output", &Config::sweepOutput, "summary file, one row per run"},
+        {"sweep", "format", &Config::sweepFormat, "summary format, 'csv' or 'json'", false, -HUGE_VAL, HUGE_VAL, {"csv", "json"}},
+        {"search", "enabled", &Config::search, "headless search of still lifes, oscillators and spaceships from small soups, then exit"},
+        {"search", "ruleset", &Config::searchRuleset, "rule of the search"},
+        {"search", "mode", &Config::searchMode, "'random' soups, or 'enumerate' every soup of up to 7x7 cells", false, -HUGE_VAL, HUGE_VAL, {"random", "enumerate"}},
+        {"search", "soups", &Config::searchSoups, "number of soups", false, 1},
+        {"search", "soup_size", &Config::searchSoupSize, "soup side in cells", false, 1, 64},
+        {"search", "density", &Config::searchDensity, "live cell probability of random soups", false, 0.0, 1.0},
+        {"search", "grid_size", &Config::searchGrid, "side of the grid of each soup, objects reaching its border are not counted", false, 8},
+        {"search", "max_steps", &Config::searchSteps, "steps before a soup is reported as unresolved", false, 1},
+        {"search", "period_max", &Config::searchPeriod, "longest detected period", false, 1},
+        {"search", "seed", &Config::searchSeed, "seed of the random soups"},
+        {"search", "output", &Config::searchOutput, "findings as RLE patterns with their statistics"},
+        {"domain", "enabled", &Config::domain, "headless run of one horizontal stripe of the grid (domain.rank of domain.ranks), then exit"},
+        {"domain", "rank", &Config::domainRank, "stripe of this process", false, 0},
+        {"domain", "ranks", &Config::domainRanks, "number of stripes and processes", false, 1},
+        {"domain", "transport", &Config::domainTransport, "halo exchange with the neighbour ranks, 'tcp' or 'shm' (POSIX shared memory)", false, -HUGE_VAL, HUGE_VAL, {"tcp", "shm"}},
+        {"domain", "host", &Config::domainHost, "tcp: host of the previous rank"},
+        {"domain", "port", &Config::domainPort, "tcp: rank r listens on port + r", false, 1, 65535},
+        {"domain", "shm_name", &Config::domainName, "shm: prefix of the shared memory segments"},
+        {"domain", "steps", &Config::domainSteps, "number of generations of the run", false, 0},
+        {"shm", "enabled", &Config::shm, "export the running grid in a POSIX shared memory segment, layout in include/gol_shm.h"},
+        {"shm", "name", &Config::shmName, "segment name, opened by the readers as /<name>"},
+        {"benchmark", "enabled", &Config::benchmark, "time every kernel for benchmark.steps steps on the configured grid, then exit"},
+        {"benchmark", "steps", &Config::benchSteps, "steps per kernel", false, 1},
+        {"export", "headless", &Config::headless, "render frames on CPU without window, then exit"},
+        {"export", "frames", &Config::exportFrames, "number of exported frames", false, 0},
+        {"export", "steps_per_frame", &Config::exportSteps, "steps between frames", false, 1},
+        {"export", "width", &Config::exportWidth, "frame width in pixels", false, 1},
+        {"export", "height", &Config::exportHeight, "frame height in pixels", false, 1},
+        {"export", "zoom", &Config::exportZoom, "zoom of the view, 1 for the whole grid, clamped like the mouse wheel", false, 1},
+        {"export", "camera", &Config::exportCamera, "[x, y] cell at the top left corner of the zoomed view, y counted from the top row, clamped to the grid"},
+        {"export", "output", &Config::exportOutput, "output file, or '|command' to pipe frames (e.g. '|ffmpeg -f rawvideo -pix_fmt rgba -s 1920x1080 -i - out.mp4')"},
+        {"export", "format", &Config::exportFormat, "'raw' RGBA frames or 'png' frames", false, -HUGE_VAL, HUGE_VAL, {"raw", "png"}},
+    };
+    return keys;
+}
+
+// Find a key of the schema, nullptr if unknown
+static const ConfigKey* findKey(const std::string& section, const std::string& name) {
+    for (const auto& k : schema()) {
+        if (section == k.section && name == k.name) return &k;
+    }
+    return nullptr;
+}
+
+// Value checks by type, an empty string when the value is accepted. Rejected values keep the current one
+static std::string readValue(bool& out, const json& v, const ConfigKey&) {
+    if (!v.is_boolean()) return "expected true or false";
+    out = v.get<bool>();
+    return "";
+}
+
+template<typename T>
+static std::string readNumber(T& out, const json& v, const ConfigKey& k) {
+    if (std::is_integral_v<T> ? !v.is_number_integer() : !v.is_number()) return std::is_integral_v<T> ? "expected an integer" : "expected a number";
+    double lo = std::max(k.min, (double)std::numeric_limits<T>::lowest());
+    double hi = std::min(k.max, (double)std::numeric_limits<T>::max());
+    double x = v.get<double>();
+    if (x < lo || x > hi) {
+        out = (T)std::clamp(x, lo, hi);
+        return std::format("out of range [{}, {}], set to {}", lo, hi, json(out).dump());
+    }
+    out = v.get<T>();
+    return "";
+}
+
+static std::string readValue(int& out, const json& v, const ConfigKey& k) { return readNumber(out, v, k); }
+static std::string readValue(float& out, const json& v, const ConfigKey& k) { return readNumber(out, v, k); }
+static std::string readValue(double& out, const json& v, const ConfigKey& k) { return readNumber(out, v, k); }
+
+static std::string readValue(std::string& out, const json& v, const ConfigKey& k) {
+    if (!v.is_string()) return "expected a string";
+    std::string s = v.get<std::string>();
+    if (!k.choices.empty() && std::find(k.choices.begin(), k.choices.end(), s) == k.choices.end()) return "unknown value '" + s + "'";
+    if (k.field == ConfigKey::Field(&Config::rulestr)) {
+        Config rules;
+        auto [ok, msg] = rules.parseRuleset(s);
+        if (!ok) return "invalid ruleset '" + s + "'";
+    }
+    out = s;
+    return "";
+}
+
+// A sweep value is a single value or an array of values
+template<typename T>
+static std::string readValue(std::vector<T>& out, const json& v, const ConfigKey& k) {
+    std::vector<T> values;
+    for (const auto& e : (v.is_array() ? v : json::array({v}))) {
+        T value{};
+        std::string err = readValue(value, e, k);
+        if (!err.empty()) return err;
+        values.push_back(value);
+    }
+    if (values.empty()) return "expected at least one value";
+    out = std::move(values);
+    return "";
+}
 
 Config::Config() {
     
@@ -30,7 +181,11 @@ void Config::initConfig(const std::string& p) {
         } catch (const std::exception& e) {
             std::cerr << "Error reading config: " << e.what() << std::endl;
         }
+        for (const auto& e : errors) std::cout << e << "\n";
     }
+    std::error_code ec;
+    loadedTime = std::filesystem::last_write_time(path, ec);
+    onDisk = toJson();
 
     // Ruleset parsing
     {auto [ok, msg] = parseRuleset(rulestr);
@@ -47,112 +202,112 @@ void Config::initConfig(const std::string& p) {
         auto [ok, msg] = parseDistType("uniform");
     }
     std::cout << msg << "\n";}
+
+    // Kernel parsing
+    {auto [ok,msg] = parseKernel(kernel);
+    if (!ok) {
+        std::cout << msg << "\n";
+        auto [ok, msg] = parseKernel("adder");
+    }
+    std::cout << msg << "\n";}
+}
+
+// Current parameters as a json object, in the layout of 'config.jsonc'
+json Config::toJson() const {
+    json j = json::object();
+    for (const auto& k : schema()) {
+        std::visit([&](auto field) { j[k.section][k.name] = this->*field; }, k.field);
+    }
+    return j;
 }
 
 // Create a new 'config.jsonc' file
 void Config::saveConfig(const std::string& path) {
-    json j = {
-        {"debug", {
-            {"checker", checker},
-            {"showfps", showfps}
-        }},
-        {"display", {
-            {"vsync", vsync},
-            {"freeze_at_start", freeze_at_start},
-        }},
-        {"grid", {
-            {"gridx", gridx},
-            {"gridy", gridy}
-        }},
-        {"window", {
-            {"width", width},
-            {"height", height}
-        }},
-        {"game", {
-            {"rulset", rulestr},
-            {"random_seed", randomSeed},
-            {"seed", seed},
-            {"dist_type", distType},
-            {"density", density}
-        }}
-    };
+    json j = toJson();
 
     std::stringstream ss;
     ss << std::setw(4) << j;
-    std::string out = ss.str();
-    out = R"(// === GAME OF LIFE CONFIG ===
-// - debug.checker          : checkerboard grid initialization
-// - debug.showfps          : fps counter in window bar
-// - display.freezeatstart  : paused simulation at start
-// - display.vsync          : vertical synchronization with the screen
-// - grid.gridx / gridy     : grid size in horizontal (x) and vertical (y) directions
-// - window.width / height    : window size
-// Changes needs restart of the application
-)" + out;
+    std::string out = "// === GAME OF LIFE CONFIG ===\n";
+    for (const auto& k : schema()) {
+        std::string key = std::string(k.section) + "." + k.name;
+        out += "// - " + key + std::string(key.size() < 26 ? 26 - key.size() : 1, ' ') + ": " + k.help + (k.live ? "" : " (restart)") + "\n";
+    }
+    out += "// Changes are applied while running when debug.hot_reload is true, except the ones marked (restart)\n";
+    out += ss.str();
     std::ofstream ofs(path);
     ofs << out;
     std::cout << "Created default config: " << path << std::endl;
 }
 
-// Loading existing 'config.jsonc'
+// Loading existing 'config.jsonc': one read and one parse, then every key is checked against the schema.
+// A bad key is reported in 'errors' and keeps its current value, the other keys are still loaded
 void Config::loadConfig(const std::string& path) {
-    std::ifstream ifs(path);
+    std::ifstream ifs(path, std::ios::binary);
     if (!ifs)
         throw std::runtime_error("Cannot open config file.");
+    std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
 
-    std::string line;
-    std::stringstream buffer;
-    while (std::getline(ifs, line)) {
-        if (!line.starts_with("//")) buffer << line << "\n";
-    }
-
-    json j = json::parse(buffer, nullptr, true, true);
+    json j = json::parse(text, nullptr, true, true);
+    if (!j.is_object()) throw std::runtime_error("Config root is not an object.");
 
-    if (j.contains("window")) {
-        auto& w = j["window"];
-        if (w.contains("width")) {
-            if (w["width"] < 800) {
-                width = 800;
-            } else {
-                width = w["width"];}
-            }
-        if (w.contains("height")) {
-            if (w["height"] < 600) {
-                height = 600;
-            } else {
-                height = w["height"];
+    errors.clear();
+    for (const auto& [section, values] : j.items()) {
+        if (!values.is_object()) {
+            errors.push_back("[Config Warning] " + section + ": expected an object, ignored");
+            continue;
+        }
+        for (const auto& [name, v] : values.items()) {
+            const ConfigKey* k = findKey(section, name);
+            if (!k) {
+                errors.push_back("[Config Warning] " + section + "." + name + ": unknown key, ignored");
+                continue;
             }
+            std::string err = std::visit([&](auto field) { return readValue(this->*field, v, *k); }, k->field);
+            if (!err.empty()) errors.push_back("[Config Error] " + section + "." + name + ": " + err + " (got " + v.dump() + ")");
         }
     }
 
-    if (j.contains("grid")) {
-        auto& g = j["grid"];
-        if (g.contains("gridx"))  gridx = g["gridx"];
-        if (g.contains("gridy"))  gridy = g["gridy"];
-    }
+    std::cout << "Configuration loaded successfully.\n";
+}
 
-    if (j.contains("debug")) {
-        auto& d = j["debug"];
-        if (d.contains("checker"))  checker = d["checker"];
-        if (d.contains("showfps"))  showfps = d["showfps"];
-    }
-    
-    if (j.contains("display")) {
-        auto& disp = j["display"];
-        if (disp.contains("vsync"))  vsync = disp["vsync"];
-        if (disp.contains("freeze_at_start"))  freeze_at_start = disp["freeze_at_start"];
-    }
+// True when 'config.jsonc' was written since it was last read
+bool Config::changedOnDisk() const {
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(path, ec);
+    return !ec && t != loadedTime;
+}
 
-    if (j.contains("game")) {
-        auto& game = j["game"];
-        if (game.contains("ruleset"))  rulestr = game["ruleset"];
-        if (game.contains("random_seed"))  randomSeed = game["random_seed"];
-        if (game.contains("seed"))  seed = game["seed"];
-        if (game.contains("dist_type"))  distType = game["dist_type"];
-        if (game.contains("density"))  density = game["density"];
+// Read 'config.jsonc' again and copy the changed live keys. Returns the changed keys as "section.key",
+// changes of keys needing a restart are reported in 'errors' and not applied
+std::vector<std::string> Config::reload() {
+    std::error_code ec;
+    loadedTime = std::filesystem::last_write_time(path, ec);
+
+    // Keys missing from the file take their defaults, as at startup
+    Config next;
+    try {
+        next.loadConfig(path);
+    } catch (const std::exception& e) {
+        errors = {std::string("[Config Error] ") + e.what() + " Config unchanged"};
+        return {};
     }
-
-    std::cout << "Configuration loaded successfully.\n";
+    errors = next.errors;
+
+    std::vector<std::string> changed;
+    for (const auto& k : schema()) {
+        std::visit([&](auto field) {
+            if (onDisk[k.section][k.name] == json(next.*field)) return;
+            std::string key = std::string(k.section) + "." + k.name;
+            if (!k.live) {
+                errors.push_back("[Config Warning] " + key + " changed, restart needed");
+                return;
+            }
+            this->*field = next.*field;
+            changed.push_back(key);
+        }, k.field);
+    }
+    onDisk = next.toJson();
+    return changed;
 }
 
 // Ruleset parsing function
@@ -227,6 +382,16 @@ std::pair<bool, std::string> Config::parseDistType(std::string disttyp) {
     }
 }
 
+// Step kernel parsing function
+std::pair<bool, std::string> Config::parseKernel(std::string name) {
+    if (name == "adder" || name == "lut") {
+        kernel = name;
+        return {true, "Selected kernel: " + name};
+    } else {
+        return {false, "[Kernel Error] Wrong kernel: " + name + ". Falling back to adder"};
+    }
+}
+
 // Recursive print of the config
 void Config::printJsonRecursive(const json& j, int indent, const std::string& prefix) const {
     std::string indentation(indent, ' ');
@@ -256,27 +421,16 @@ void Config::printJsonRecursive(const json& j, int indent, const std::string& pr
     }
 }
 
-// Prints all params in the console + additionnal info
+// Prints all params in the console + additionnal info. Values are the ones in use, command line overrides included
 void Config::printAllParams() const {
-    std::ifstream ifs(path);
-    if (!ifs) {
-        std::cerr << "Cannot open config file for reading.\n";
-        return;
-    }
-
-    std::string line;
-    std::stringstream buffer;
-    while (std::getline(ifs, line)) {
-        if (!line.starts_with("//")) buffer << line << "\n";
-    }
-
-    json j = json::parse(buffer, nullptr, true, true);
+    json j = toJson();
 
     std::cout << "=== CONFIGURATION PARAMETERS ===\n";
     printJsonRecursive(j, 0);
     std::cout << "========= KEY BINDINGS =========\n";
     std::cout << "Pause/unpause simulation  : Space\n";
     std::cout << "One time step             : Right arrow\n";
+    std::cout << "Step back (history)       : Left arrow\n";
     std::cout << "Open/Close console        : F1\n";
     std::cout << "=========== COMMANDS ===========\n";
     std::cout << "help                      : show help for commands\n";
@@ -284,7 +438,10 @@ void Config::printAllParams() const {
     std::cout << "step                      : do one simulation step\n";
     std::cout << "step <n_steps> <delay>    : do n_steps simulation steps with delay in seconds\n";
     std::cout << "regen                     : regenerate random grid\n";
+    std::cout << "bench <n_steps>           : time every step kernel\n";
+    std::cout << "trace <start|stop|save> [path] : record timed scopes, save them as Chrome trace JSON\n";
     std::cout << "set <width> <height>      : set global property (windowSize, gridSize)\n";
-    std::cout << "get <globalProperty>      : print current global property (windowSize, gridSize, ruleSet, seed, dist)\n";
+    std::cout << "set gridSize <x> <y> [center|corner] : resize the grid and keep the current pattern\n";
+    std::cout << "get <globalProperty>      : print current global property (windowSize, gridSize, ruleSet, seed, dist, world)\n";
     std::cout << "================================\n";
 }
\ No newline at end of file
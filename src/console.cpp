@@ -12,8 +12,8 @@
 #include <iostream>
 #include <algorithm>
 
-Console::Console(Config* cfg, Window* win, Grid* grid, Renderer* renderer)
-    : cfg(cfg), win(win), grid(grid), renderer(renderer)
+Console::Console(Config* cfg, Window* win, Grid* grid, Renderer* renderer, Scheduler* scheduler, History* history)
+    : cfg(cfg), win(win), grid(grid), renderer(renderer), scheduler(scheduler), history(history)
 {
 
 }
@@ -27,29 +27,33 @@ void Console::initConsole() {
     // Initialization of VAO, VBOs and console shader
     vao = std::make_unique<GLVertexBuffer>();
     vbo = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
-    vboLogs = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
-    vboInput = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
-    vboSuggest = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
     shaders = std::make_unique<GLProgram>(consoleVert, consoleFrag);
+    uScreen = shaders->uniform("uScreen");
+    uColor = shaders->uniform("uColor");
+    initAtlas();
 
     // print available commands in the console
     log("Available commands:");
     log("  start / stop / regen");
     log("  step <n_steps> <delay>");
+    log("  bench <n_steps>");
+    log("  trace <start|stop|save> [path]");
     log("  get <globalProperty>");
     log("  set <globalProperty> [values]");
     log("Available globalProperties:");
-    log("  windowSize | gridSize | ruleSet | seed | dist");
+    log("  windowSize | gridSize | ruleSet | seed | dist | heatmap | speed | kernel");
 
     // help command implementation
     root.add("help", [&](const auto&) {
         log("Available commands:");
         log("  start / stop / regen");
         log("  step <n_steps> <delay>");
+        log("  bench <n_steps>");
+        log("  trace <start|stop|save> [path]");
         log("  get <globalProperty>");
         log("  set <globalProperty> [values]");
         log("Available globalProperties:");
-        log("  windowSize | gridSize | ruleSet | seed | dist");
+        log("  windowSize | gridSize | ruleSet | seed | dist | heatmap | speed | kernel");
     });
     
     // start command implementation
@@ -85,10 +89,34 @@ void Console::initConsole() {
         } else log("Usage: step <int> [float]");
     });
 
+    // bench command implementation : time every step kernel on a copy of the current grid size
+    root.add("bench", [&](const auto& args){
+        if (args.size() == 1) command_bench(100);
+        else if (args.size() == 2) {
+            auto n = from_string<int>(args[1]);
+            if (!n || *n < 1) log("Usage: bench <int>");
+            else command_bench(*n);
+        } else log("Usage: bench [int]");
+    });
+
+    // trace command implementation : record the timed scopes of the hot paths, save them as Chrome trace JSON
+    auto& trace = root.add("trace");
+    trace.add("start", [&](auto&){ command_trace("start"); });
+    trace.add("stop",  [&](auto&){ command_trace("stop"); });
+    trace.add("save",  [&](auto& args){
+        if (args.size() > 3) log("Usage: trace save [path]");
+        else command_trace("save", args.size() == 3 ? args[2] : "trace.json");
+    });
+
     // get command implementation
     auto& get = root.add("get");
     get.add("windowSize", [&](auto&){ getWindowSize(); });
     get.add("gridSize",   [&](auto&){ getGridSize(); });
+    get.add("world",      [&](auto&){ getWorld(); });
+    get.add("history",    [&](auto&){ getHistory(); });
+    get.add("speed",      [&](auto&){ getSpeed(); });
+    get.add("heatmap",    [&](auto&){ log(std::format("heatmap: {}", cfg->heatmap ? "on" : "off")); });
+    get.add("kernel",     [&](auto&){ log("kernel: " + cfg->kernel); });
 
     // set command implementation
     auto& set = root.add("set");
@@ -121,21 +149,26 @@ void Console::initConsole() {
     
     // gridSize property
     set.add("gridSize",   [&](auto& args){
-        if (args.size() != 4) {
-            log("Usage: set gridSize <int> <int>");
+        if (args.size() != 4 && args.size() != 5) {
+            log("Usage: set gridSize <int> <int> [center|corner]");
             return;
         }
 
         auto gx = from_string<int>(args[2]);
         auto gy = from_string<int>(args[3]);
+        bool centered = true;
+        if (args.size() == 5) {
+            if (args[4] == "corner") centered = false;
+            else if (args[4] != "center") gx.reset();
+        }
 
-        if (!gx || !gy) {
+        if (!gx || !gy || *gx < 1 || *gy < 1) {
             log("Error: invalid arguments");
-            log("Usage: set gridSize <int> <int>");
+            log("Usage: set gridSize <int> <int> [center|corner]");
             return;
         }
 
-        setGridSize(*gx, *gy);
+        setGridSize(*gx, *gy, centered);
         return;
     });
 
@@ -172,6 +205,42 @@ void Console::initConsole() {
         return;
     });
 
+    // speed property: generations per second, or max
+    set.add("speed", [&](auto& args){
+        if (args.size() != 3) {
+            log("Usage: set speed <float|max>");
+            return;
+        }
+        auto rate = (args[2] == "max") ? std::optional<double>(0.0) : from_string<double>(args[2]);
+        if (!rate || *rate < 0.0) {
+            log("Error: invalid argument '" + args[2] + "'");
+            log("Usage: set speed <float|max>");
+            return;
+        }
+        setSpeed(*rate);
+        return;
+    });
+
+    // heatmap property
+    set.add("heatmap", [&](auto& args){
+        if (args.size() != 3 || (args[2] != "on" && args[2] != "off")) {
+            log("Usage: set heatmap <on|off>");
+            return;
+        }
+        setHeatmap(args[2] == "on");
+        return;
+    });
+
+    // kernel property
+    set.add("kernel", [&](auto& args){
+        if (args.size() != 3) {
+            log("Usage: set kernel <adder|lut>");
+            return;
+        }
+        setKernel(args[2]);
+        return;
+    });
+
     // dist property
     set.add("dist", [&](auto& args){
         if (args.size() != 3 && args.size() != 4) {
@@ -231,6 +300,48 @@ void Console::executeCommand(const CommandNode& root, const std::vector<std::str
 void Console::log(const std::string& s) {
     lines.push_back(s);
     if (lines.size() > 1000) lines.erase(lines.begin());
+    logsDirty = true;
+    progressLine = false;
+}
+
+// Progress of a task, updated in place on the last line while nothing else is logged
+void Console::progress(const std::string& s, bool last) {
+    if (progressLine && !lines.empty()) {
+        lines.back() = s;
+        logsDirty = true;
+    } else {
+        log(s);
+    }
+    progressLine = !last;
+}
+
+// Add a task at the end of the queue
+void Console::enqueue(const std::string& name, std::function<bool(Task&)> advance) {
+    tasks.push_back(Task{name, std::move(advance), 0.0});
+}
+
+// Advance the current task by one slice, called once per frame by the main loop. Ctrl+C aborts the current task
+void Console::update() {
+    if (tasks.empty()) {
+        abortRequested = false;
+        return;
+    }
+    Task& task = tasks.front();
+    if (!abortRequested && glfwGetTime() < task.wakeTime) return;
+
+    if (task.advance(task)) {
+        tasks.pop_front();
+        abortRequested = false;
+    }
+}
+
+// Time at which the current task wakes up, 0 when no task is waiting
+double Console::nextWakeTime() const {
+    return tasks.empty() ? 0.0 : tasks.front().wakeTime;
+}
+
+bool Console::hasTask() const {
+    return !tasks.empty();
 }
 
 // To be simplified with Console::executeCommand function
@@ -290,12 +401,63 @@ std::vector<std::string> Console::suggest(const CommandNode& root, const std::ve
     return matches;
 }
 
+// Bake the font in a 16 x 8 glyphs texture and set up the instanced quad
+void Console::initAtlas() {
+    std::vector<uint8_t> texels(128 * 64, 0);
+    for (int c = 0; c < 128; ++c) {
+        int ox = (c % 16) * 8;
+        int oy = (c / 16) * 8;
+        for (int row = 0; row < 8; row++) {
+            for (int col = 0; col < 8; col++) {
+                if (font8x8_basic[c][row] & (1 << col)) texels[(oy + row) * 128 + ox + col] = 255;
+            }
+        }
+    }
+    atlas = std::make_unique<GLTexture2D>();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    atlas->allocate(GL_R8, 128, 64, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+
+    textShaders = std::make_unique<GLProgram>(textVert, textFrag);
+    uTextScreen = textShaders->uniform("uScreen");
+    uTextColor = textShaders->uniform("uColor");
+    uAtlas = textShaders->uniform("uAtlas");
+
+    // Unit quad shared by every glyph, instances are read from the buffer bound at draw time
+    static const float quad[12] = {
+        0, 0,  1, 0,  1, 1,
+        0, 0,  1, 1,  0, 1
+    };
+    vaoText = std::make_unique<GLVertexBuffer>();
+    vboQuad = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
+    vboLogs = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
+    vboInput = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
+    vboSuggest = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
+
+    vaoText->bind();
+    vboQuad->bind();
+    vboQuad->set_data(sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    logsDirty = true;
+}
+
+// Draw glyph instances stored in a buffer, one quad per glyph
+void Console::drawGlyphs(const GLBuffer& buffer, size_t count, float r, float g, float b, float a) {
+    if (count == 0) return;
+    buffer.bind();
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    textShaders->setVec4(uTextColor, r, g, b, a);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)count);
+}
+
 // Draw function for the console
 void Console::draw() {
+    TRACE_SCOPE("console draw");
     if (!visible) return;
-    pts.clear();
-    ptsInput.clear();
-    ptsSuggest.clear();
+    glyphsInput.clear();
+    glyphsSuggest.clear();
     shaders->use();
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
@@ -317,19 +479,28 @@ void Console::draw() {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
     glEnableVertexAttribArray(0);
 
-    glUniform2f(glGetUniformLocation(shaders->get(), "uScreen"), (float)fbWidth, (float)fbHeight);
-    glUniform4f(glGetUniformLocation(shaders->get(), "uColor"), 0.0f, 0.0f, 0.15f, 0.75f);
+    shaders->setVec2(uScreen, (float)fbWidth, (float)fbHeight);
+    shaders->setVec4(uColor, 0.0f, 0.0f, 0.15f, 0.75f);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
     int lineHeight = 10;
     maxVisibleLines = (int)(cHeight / lineHeight) - 3;
     if (maxVisibleLines < 1) maxVisibleLines = 1;
 
-    int y = 10;
-    int end = std::min((int)lines.size(), lineOffset + maxVisibleLines);
-    for (int i = lineOffset; i < end; i++) {
-        appendText(pts, 10, y, lines[i]);
-        y += lineHeight;
+    // Log glyphs are uploaded again only when needed
+    if (logsDirty || cachedOffset != lineOffset || cachedVisible != maxVisibleLines) {
+        glyphsLogs.clear();
+        int y = 10;
+        int end = std::min((int)lines.size(), lineOffset + maxVisibleLines);
+        for (int i = lineOffset; i < end; i++) {
+            appendText(glyphsLogs, 10, y, lines[i]);
+            y += lineHeight;
+        }
+        vboLogs->bind();
+        vboLogs->set_data(glyphsLogs.size() * sizeof(float), glyphsLogs.data(), GL_DYNAMIC_DRAW);
+        logsDirty = false;
+        cachedOffset = lineOffset;
+        cachedVisible = maxVisibleLines;
     }
 
     auto tokens = std::vector<std::string>();
@@ -369,11 +540,11 @@ void Console::draw() {
     }
 
     std::string prompt = "> " + input;
-    appendText(ptsInput, 10, cHeight - lineHeight, prompt);
+    appendText(glyphsInput, 10, cHeight - lineHeight, prompt);
 
     int inputPixelWidth = static_cast<int>(prompt.size() * 8);
     if (!suggestionText.empty()) {
-        appendText(ptsSuggest, 10 + inputPixelWidth, cHeight - lineHeight, suggestionText);
+        appendText(glyphsSuggest, 10 + inputPixelWidth, cHeight - lineHeight, suggestionText);
     }
 
     if (!currentSuggestions.empty()) {
@@ -385,29 +556,23 @@ void Console::draw() {
                 all += currentSuggestions[i]+" ";
         }
         all += "]";
-        appendText(ptsSuggest, 10, cHeight - 2*lineHeight, all);
+        appendText(glyphsSuggest, 10, cHeight - 2*lineHeight, all);
     }
 
-    vboLogs->bind();
-    vboLogs->set_data(pts.size() * sizeof(float), pts.data(), GL_STREAM_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glEnableVertexAttribArray(0);
-    glUniform4f(glGetUniformLocation(shaders->get(), "uColor"), 0.0f, 1.0f, 0.0f, 1.0f);
-    glDrawArrays(GL_POINTS, 0, pts.size() / 2);
-
+    // Input and suggestions are a few glyphs, rebuilt every frame
     vboInput->bind();
-    vboInput->set_data(ptsInput.size() * sizeof(float), ptsInput.data(), GL_STREAM_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glEnableVertexAttribArray(0);
-    glUniform4f(glGetUniformLocation(shaders->get(), "uColor"), 0.0f, 1.0f, 0.0f, 1.0f);
-    glDrawArrays(GL_POINTS, 0, ptsInput.size() / 2);
-
+    vboInput->set_data(glyphsInput.size() * sizeof(float), glyphsInput.data(), GL_STREAM_DRAW);
     vboSuggest->bind();
-    vboSuggest->set_data(ptsSuggest.size() * sizeof(float), ptsSuggest.data(), GL_STREAM_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glEnableVertexAttribArray(0);
-    glUniform4f(glGetUniformLocation(shaders->get(), "uColor"), 0.9f, 0.15f, 0.15f, 0.8f);
-    glDrawArrays(GL_POINTS, 0, ptsSuggest.size() / 2);
+    vboSuggest->set_data(glyphsSuggest.size() * sizeof(float), glyphsSuggest.data(), GL_STREAM_DRAW);
+
+    textShaders->use();
+    atlas->bind(0);
+    textShaders->setInt(uAtlas, 0);
+    textShaders->setVec2(uTextScreen, (float)fbWidth, (float)fbHeight);
+    vaoText->bind();
+    drawGlyphs(*vboLogs, glyphsLogs.size() / 3, 0.0f, 1.0f, 0.0f, 1.0f);
+    drawGlyphs(*vboInput, glyphsInput.size() / 3, 0.0f, 1.0f, 0.0f, 1.0f);
+    drawGlyphs(*vboSuggest, glyphsSuggest.size() / 3, 0.9f, 0.15f, 0.15f, 0.8f);
 
     glDisable(GL_BLEND);
 }
@@ -495,71 +660,130 @@ void Console::handleChar(unsigned int codepoint) {
     }
 }
 
-// Append text to a vector, to be rendered as points, using font file
-void Console::appendText(std::vector<float>& pts, int x, int y, const std::string& text) {
+// Append text to a vector of glyph instances, one per character, non ASCII characters are shown as '?'
+void Console::appendText(std::vector<float>& glyphs, int x, int y, const std::string& text) {
     for (size_t i = 0; i < text.size(); i++) {
         unsigned char c = text[i];
-        for (int row = 0; row < 8; row++) {
-            for (int col = 0; col < 8; col++) {
-                if (font8x8_basic[c][row] & (1 << col)) {
-                    pts.push_back((float)(x + col + i*8));
-                    pts.push_back((float)(y + row));
-                }
-            }
-        }
+        if (c == ' ') continue;
+        if (c > 127) c = '?';
+        glyphs.push_back((float)(x + i*8));
+        glyphs.push_back((float)y);
+        glyphs.push_back((float)c);
     }
 }
 
 void Console::command_start() {
     grid->pause = false;
-    if (cfg->vsync) {
-        glfwSwapInterval(1);
-    } else {
-        glfwSwapInterval(0);
-    }
 }
 
 void Console::command_stop() {
     grid->pause = true;
-    glfwSwapInterval(1);
 }
 
+// Regenerate the grid as a queued task, after the steps already queued
 void Console::command_regen() {
-    grid->initSeed();
-    grid->initRandomGrid();
+    enqueue("regen", [this](Task&) {
+        double start = glfwGetTime();
+        grid->initSeed();
+        grid->initRandomGrid();
+        log(std::format("Regenerated in {:.0f} ms.", (glfwGetTime() - start) * 1000.0));
+        return true;
+    });
 }
 
-// Alternative render loop to make on command n_steps with a delay between steps, cancellable with Crtl+C
+// Queue n_steps steps with a delay between steps, cancellable with Crtl+C.
+// Without delay, steps are done by slices of taskBudget per frame so the window stays responsive
 void Console::command_step(int n_step, float delay) {
     grid->pause = true;
+    if (n_step <= 0) {
+        log("0 steps done.");
+        return;
+    }
 
-    double lastTime = glfwGetTime();
-    double remain_time = 0.0;
-
-    if (!cfg->vsync) glfwSwapInterval(0);
-    for (int i = 0; i < n_step;) {
+    int done = 0;
+    enqueue("step", [this, n_step, delay, done](Task& task) mutable {
         if (abortRequested) {
-            log(std::format("Aborted. {} steps done.", i));
-            break;
+            progress(std::format("Aborted. {} steps done.", done), true);
+            return true;
         }
-        
-        remain_time = delay - (glfwGetTime() - lastTime);
-        if (remain_time < 0) {
+
+        double start = glfwGetTime();
+        do {
             grid->step();
-            ++i;
-            lastTime = glfwGetTime();
+            ++done;
+        } while (done < n_step && delay <= 0.0f && glfwGetTime() - start < taskBudget);
+
+        if (done >= n_step) {
+            progress(std::format("{} steps done.", n_step), true);
+            return true;
         }
-        
-        renderer->render();
-        draw();
-        glfwSwapBuffers(win->get());
-        glfwPollEvents();
-    }
-    if (!abortRequested) log(std::format("{} steps done.", n_step));
 
-    glfwSwapInterval(1);
+        // Sleep until the next delayed step, the main loop waits for events meanwhile
+        if (delay > 0.0f) task.wakeTime = glfwGetTime() + delay;
+        progress(std::format("step: {}/{}", done, n_step));
+        return false;
+    });
+}
+
+// Queue a benchmark of every kernel, by slices of taskBudget steps so the window stays responsive. The grid used is a
+// copy of the current size, not the current pattern
+void Console::command_bench(int n_step) {
+    size_t next = 0;
+    auto results = std::make_shared<std::vector<BenchResult>>();
+    std::shared_ptr<BenchRun> run;
+    log(std::format("bench: {} steps per kernel on a {}x{} grid", n_step, cfg->gridx, cfg->gridy));
+    enqueue("bench", [this, n_step, next, results, run](Task&) mutable {
+        const std::vector<std::string>& kernels = Benchmark::kernels();
+        if (abortRequested) {
+            progress(std::format("Aborted. {} kernels of {} done.", results->size(), kernels.size()), true);
+            return true;
+        }
+
+        // The grid of a kernel is set up in its own slice
+        if (!run) {
+            run = std::make_shared<BenchRun>(cfg, kernels[next], n_step);
+            progress(std::format("bench: {} 0/{}", kernels[next], n_step));
+            return false;
+        }
+        if (!run->advance(taskBudget)) {
+            progress(std::format("bench: {} {}/{}", kernels[next], run->stepsDone(), n_step));
+            return false;
+        }
+        results->push_back(run->result());
+        run.reset();
+        if (++next < kernels.size()) return false;
+
+        progress(std::format("bench: {} kernels done.", kernels.size()), true);
+        std::string report = Benchmark::report(*results);
+        size_t pos = 0, end;
+        while ((end = report.find('\n', pos)) != std::string::npos) {
+            log(report.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        return true;
+    });
+}
 
-    abortRequested = false;
+// Start or stop recording the traces, or save the recorded ones
+void Console::command_trace(const std::string& action, const std::string& path) {
+    if (!Trace::compiled()) {
+        log("[Warning] traces not compiled in, configure with -DGOL_TRACE=ON");
+        return;
+    }
+    if (action == "start") {
+        Trace::start();
+        log("trace: recording");
+    } else if (action == "stop") {
+        Trace::stop();
+        log("trace: stopped");
+    } else {
+        try {
+            size_t n = Trace::write(path);
+            log(std::format("trace: {} events written to {}", n, path));
+        } catch (const std::exception& e) {
+            log(e.what());
+        }
+    }
 }
 
 // Function to set window size with a minimum of 800x600
@@ -571,25 +795,21 @@ void Console::setWindowSize(int w, int h) {
         cfg->width = w;
     }
     if (h < 600) {
-        cfg->width = 600;
+        cfg->height = 600;
         log("[Warning] minimum window height is 600");
     } else {
-        cfg->width = h;
+        cfg->height = h;
     }
     if (win->get()) {
-        glfwSetWindowSize(win->get(), w, h);
+        glfwSetWindowSize(win->get(), cfg->width, cfg->height);
         renderer->initRender();
         renderer->render();
     }
 }
 
-// Function to set grid size
-void Console::setGridSize(int x, int y) {
-    cfg->gridx = x;
-    cfg->gridy = y;
-    grid->initSize();
-    grid->initMask();
-    grid->initRandomGrid();
+// Function to set grid size, the current pattern is kept centered or anchored to the top left corner
+void Console::setGridSize(int x, int y, bool centered) {
+    grid->resize(x, y, centered);
     renderer->initRender();
     renderer->render();
 }
@@ -641,6 +861,90 @@ void Console::getGridSize() {
     log(std::format("grid size: {}x{}", cfg->gridx, cfg->gridy));
 }
 
+// Set the target simulation rate, 0 for as fast as possible
+void Console::setSpeed(double gensPerSecond) {
+    cfg->speed = gensPerSecond;
+    scheduler->setRate(gensPerSecond);
+    getSpeed();
+}
+
+// Log the target and achieved simulation rates
+void Console::getSpeed() {
+    std::string target = (scheduler->getRate() > 0.0) ? std::format("{} gens/s", scheduler->getRate()) : "max";
+    log(std::format("speed: target {}, achieved {:.1f} gens/s", target, scheduler->getAchievedRate()));
+}
+
+// Enable or disable the heat map, ages restart from cold cells
+void Console::setHeatmap(bool on) {
+    cfg->heatmap = on;
+    grid->initHeat();
+    renderer->render();
+    log(std::format("heatmap: {}", on ? "on" : "off"));
+}
+
+// Select the step kernel, the lookup table is built for the current rule
+void Console::setKernel(std::string name) {
+    auto [ok, msg] = cfg->parseKernel(name);
+    log(msg);
+    if (ok) grid->initRuleset();
+}
+
+// Log the unbounded world size in console
+void Console::getWorld() {
+    if (!grid->world) {
+        log("world: bounded (grid.unbounded is false)");
+        return;
+    }
+    log(std::format("world: {} chunks, {} live cells, view at ({}, {})",
+        grid->world->chunkCount(), grid->world->population(), grid->originX, grid->originY));
+}
+
+// Log the generations held by the history and its memory use
+void Console::getHistory() {
+    if (!history) {
+        log("history: disabled (history.enabled is false)");
+        return;
+    }
+    log(std::format("history: {} generations from {} to {}, {} keyframes, {:.1f} MB",
+        history->frameCount(), history->oldestGeneration(), grid->generation, history->keyframeCount(),
+        history->memoryBytes() / 1048576.0));
+}
+
+// Apply the keys changed in 'config.jsonc' since it was read, each with the same path as its console command
+void Console::reloadConfig() {
+    Config before = *cfg;
+    std::vector<std::string> changed = cfg->reload();
+    for (const auto& e : cfg->errors) log(e);
+    if (changed.empty()) return;
+
+    auto has = [&](const std::string& key) { return std::find(changed.begin(), changed.end(), key) != changed.end(); };
+    std::string keys;
+    for (const auto& k : changed) keys += (keys.empty() ? "" : ", ") + k;
+    log("config reloaded: " + keys);
+
+    if (has("grid.threads")) grid->initThreads();
+    if (has("grid.gridx") || has("grid.gridy")) {
+        int x = cfg->gridx, y = cfg->gridy;
+        cfg->gridx = before.gridx;
+        cfg->gridy = before.gridy;
+        setGridSize(x, y);
+    }
+    if (has("game.ruleset") || has("grid.kernel")) setRuleset(cfg->rulestr);
+    if (has("game.dist_type") || has("game.density")) cfg->parseDistType(cfg->distType);
+    if (has("game.seed") || has("game.random_seed") || has("game.dist_type") || has("game.density") || has("debug.checker")) {
+        grid->initSeed();
+        if (cfg->checker) grid->initCheckerGrid();
+        else grid->initRandomGrid();
+    }
+    if (has("display.heatmap")) setHeatmap(cfg->heatmap);
+    if (has("game.speed")) setSpeed(cfg->speed);
+    if (has("display.vsync") && win->get()) glfwSwapInterval(cfg->vsync ? 1 : 0);
+    if (has("window.width") || has("window.height")) setWindowSize(cfg->width, cfg->height);
+    if (history && (has("history.memory_mb") || has("history.keyframe_interval"))) {
+        history->init((size_t)cfg->historyMemory << 20, cfg->historyKeyframes);
+    }
+}
+
 void Console::cleanup() {
 
 }
\ No newline at end of file
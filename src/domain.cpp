@@ -0,0 +1,393 @@
+#include "domain.hpp"
+#include "trace.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socket_t = SOCKET;
+static constexpr socket_t badSocket = INVALID_SOCKET;
+#define closesock closesocket
+#else
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+using socket_t = int;
+static constexpr socket_t badSocket = -1;
+#define closesock close
+#endif
+
+// Shared memory segment of a boundary: a header, then one channel per direction, lower to upper rank first.
+// A channel is a single row slot: the writer waits for the reader to acknowledge the previous row before writing the next one.
+struct ShmHeader {
+    std::atomic<uint64_t> ready;
+    uint64_t words;
+};
+
+struct ShmChannel {
+    alignas(64) std::atomic<uint64_t> seq;
+    alignas(64) std::atomic<uint64_t> ack;
+};
+
+static constexpr size_t shmHeaderBytes = 64;
+static constexpr size_t shmChannelBytes = sizeof(ShmChannel);
+static constexpr uint64_t shmMagic = 0x474F4C48414C4F31ULL; // "GOLHALO1"
+
+// Timeout for the neighbour ranks to show up
+static constexpr double connectTimeout = 60.0;
+
+// Busy wait for a short time, then give the core away
+static void backoff(int& spins) {
+    if (++spins > 256) std::this_thread::yield();
+}
+
+Domain::Domain(Config* cfg) {
+    this->cfg = cfg;
+}
+
+Domain::~Domain() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+    closeLink(up);
+    closeLink(down);
+}
+
+// Split the global grid rows between the ranks, the grid of this process becomes its stripe
+void Domain::initStripe() {
+    ranks = cfg->domainRanks;
+    rank = cfg->domainRank;
+    if (ranks < 1 || rank < 0 || rank >= ranks) {
+        throw std::runtime_error(std::format("[Fatal] Bad domain rank {} of {}", rank, ranks));
+    }
+    if (cfg->gridy < ranks) {
+        throw std::runtime_error(std::format("[Fatal] {} rows cannot be split in {} stripes", cfg->gridy, ranks));
+    }
+    firstRow = (int)((int64_t)cfg->gridy * rank / ranks);
+    stripeRows = (int)((int64_t)cfg->gridy * (rank + 1) / ranks) - firstRow;
+    cfg->gridy = stripeRows;
+
+    up.active = rank > 0;
+    up.lower = false;
+    down.active = rank < ranks - 1;
+    down.lower = true;
+}
+
+// Connect to the neighbour ranks and start the exchange thread, words is the row length of the grid
+void Domain::connect(int words) {
+    if (cfg->domainTransport == "tcp") {
+        shm = false;
+        connectTcp(words);
+    } else if (cfg->domainTransport == "shm") {
+        shm = true;
+        connectShm(words);
+    } else {
+        throw std::runtime_error("[Fatal] Bad domain transport: " + cfg->domainTransport);
+    }
+    if (!worker.joinable()) worker = std::thread(&Domain::loop, this);
+}
+
+// TCP links: accept the rank below on port + rank, connect to the rank above on port + rank - 1
+void Domain::connectTcp(int words) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) throw std::runtime_error("[Fatal] Cannot initialize winsock");
+#endif
+    auto address = [&](int port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, cfg->domainHost.c_str(), &addr.sin_addr) != 1) {
+            throw std::runtime_error("[Fatal] Bad domain host: " + cfg->domainHost);
+        }
+        return addr;
+    };
+    auto noDelay = [](socket_t s) {
+        int one = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+    };
+
+    // Listen first, so that the rank below can connect while this one waits for the rank above
+    socket_t listener = badSocket;
+    if (down.active) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+        sockaddr_in addr = address(cfg->domainPort + rank);
+        if (listener == badSocket || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listener, 1) != 0) {
+            if (listener != badSocket) closesock(listener);
+            throw std::runtime_error(std::format("[Fatal] Cannot listen on port {}", cfg->domainPort + rank));
+        }
+    }
+
+    if (up.active) {
+        sockaddr_in addr = address(cfg->domainPort + rank - 1);
+        auto start = std::chrono::steady_clock::now();
+        while (true) {
+            socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+            if (s != badSocket && ::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+                up.sock = (intptr_t)s;
+                break;
+            }
+            if (s != badSocket) closesock(s);
+            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > connectTimeout) {
+                if (listener != badSocket) closesock(listener);
+                throw std::runtime_error(std::format("[Fatal] Rank {} did not answer on port {}", rank - 1, cfg->domainPort + rank - 1));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        noDelay((socket_t)up.sock);
+    }
+
+    if (down.active) {
+        socket_t s = accept(listener, nullptr, nullptr);
+        closesock(listener);
+        if (s == badSocket) throw std::runtime_error(std::format("[Fatal] Rank {} could not connect", rank + 1));
+        down.sock = (intptr_t)s;
+        noDelay(s);
+    }
+
+    // Both sides of a link check that they agree on the rank order and the row length
+    for (Link* link : {&up, &down}) {
+        if (!link->active) continue;
+        uint64_t mine[2] = {(uint64_t)rank, (uint64_t)words};
+        uint64_t theirs[2] = {0, 0};
+        if (link->lower) {
+            sendRow(*link, mine, 2);
+            recvRow(*link, theirs, 2);
+        } else {
+            recvRow(*link, theirs, 2);
+            sendRow(*link, mine, 2);
+        }
+        int expected = link->lower ? rank + 1 : rank - 1;
+        if (theirs[0] != (uint64_t)expected || theirs[1] != (uint64_t)words) {
+            throw std::runtime_error(std::format("[Fatal] Rank {} has rank {} and {} words per row, expected rank {} and {} words",
+                expected, theirs[0], theirs[1], expected, words));
+        }
+    }
+}
+
+// Shared memory links: the lower rank of each boundary creates its segment, the upper rank maps it
+void Domain::connectShm(int words) {
+#ifdef _WIN32
+    (void)words;
+    throw std::runtime_error("[Fatal] The shm domain transport needs POSIX shared memory, use tcp");
+#else
+    size_t channel = shmChannelBytes + ((size_t)words * sizeof(uint64_t) + 63) / 64 * 64;
+    size_t bytes = shmHeaderBytes + 2 * channel;
+
+    auto name = [&](int boundary) {
+        return "/" + cfg->domainName + "_" + std::to_string(boundary);
+    };
+    auto map = [&](Link& link, int fd) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("[Fatal] Cannot map the halo shared memory");
+        link.map = p;
+        link.mapBytes = bytes;
+        unsigned char* base = static_cast<unsigned char*>(p);
+        unsigned char* first = base + shmHeaderBytes;
+        unsigned char* second = first + channel;
+        link.out = link.lower ? first : second;
+        link.in = link.lower ? second : first;
+    };
+
+    // Boundary below this rank: a new segment, zero filled by ftruncate, marked ready once set up
+    if (down.active) {
+        std::string n = name(rank);
+        shm_unlink(n.c_str());
+        int fd = shm_open(n.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("[Fatal] Cannot create shared memory " + n);
+        }
+        map(down, fd);
+        ShmHeader* h = static_cast<ShmHeader*>(down.map);
+        h->words = (uint64_t)words;
+        h->ready.store(shmMagic, std::memory_order_release);
+    }
+
+    // Boundary above this rank: wait for the segment of the rank above, its name is removed once both sides mapped it
+    if (up.active) {
+        std::string n = name(rank - 1);
+        auto start = std::chrono::steady_clock::now();
+        while (true) {
+            int fd = shm_open(n.c_str(), O_RDWR, 0600);
+            struct stat st{};
+            if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size == bytes) {
+                map(up, fd);
+                if (static_cast<ShmHeader*>(up.map)->ready.load(std::memory_order_acquire) == shmMagic) break;
+                munmap(up.map, up.mapBytes);
+                up.map = nullptr;
+            } else if (fd >= 0) {
+                close(fd);
+            }
+            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > connectTimeout) {
+                throw std::runtime_error(std::format("[Fatal] No shared memory {} of {} bytes from rank {}", n, bytes, rank - 1));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        if (static_cast<ShmHeader*>(up.map)->words != (uint64_t)words) {
+            throw std::runtime_error("[Fatal] Rank " + std::to_string(rank - 1) + " has another row length");
+        }
+        shm_unlink(n.c_str());
+    }
+#endif
+}
+
+// Close the socket or unmap the segment of a link
+void Domain::closeLink(Link& link) {
+    if (link.sock != -1) {
+        closesock((socket_t)link.sock);
+        link.sock = -1;
+    }
+#ifndef _WIN32
+    if (link.map) {
+        munmap(link.map, link.mapBytes);
+        // The segment name is normally gone already, this cleans up when the rank below never showed up
+        if (link.lower) shm_unlink(("/" + cfg->domainName + "_" + std::to_string(rank)).c_str());
+        link.map = nullptr;
+    }
+#endif
+}
+
+// Blocking send of a row to the neighbour of a link
+void Domain::sendRow(Link& link, const uint64_t* row, size_t words) {
+    if (shm) {
+        ShmChannel* ch = reinterpret_cast<ShmChannel*>(link.out);
+        uint64_t s = ch->seq.load(std::memory_order_relaxed);
+        int spins = 0;
+        while (ch->ack.load(std::memory_order_acquire) != s) backoff(spins);
+        std::memcpy(link.out + shmChannelBytes, row, words * sizeof(uint64_t));
+        ch->seq.store(s + 1, std::memory_order_release);
+        return;
+    }
+    const char* p = reinterpret_cast<const char*>(row);
+    size_t left = words * sizeof(uint64_t);
+    while (left > 0) {
+        int n = (int)send((socket_t)link.sock, p, (int)std::min<size_t>(left, 1 << 30), 0);
+        if (n <= 0) throw std::runtime_error("[Fatal] Halo send failed, a neighbour rank is gone");
+        p += n;
+        left -= n;
+    }
+}
+
+// Blocking receive of a row from the neighbour of a link
+void Domain::recvRow(Link& link, uint64_t* row, size_t words) {
+    if (shm) {
+        ShmChannel* ch = reinterpret_cast<ShmChannel*>(link.in);
+        uint64_t a = ch->ack.load(std::memory_order_relaxed);
+        int spins = 0;
+        while (ch->seq.load(std::memory_order_acquire) == a) backoff(spins);
+        std::memcpy(row, link.in + shmChannelBytes, words * sizeof(uint64_t));
+        ch->ack.store(a + 1, std::memory_order_release);
+        return;
+    }
+    char* p = reinterpret_cast<char*>(row);
+    size_t left = words * sizeof(uint64_t);
+    while (left > 0) {
+        int n = (int)recv((socket_t)link.sock, p, (int)std::min<size_t>(left, 1 << 30), 0);
+        if (n <= 0) throw std::runtime_error("[Fatal] Halo receive failed, a neighbour rank is gone");
+        p += n;
+        left -= n;
+    }
+}
+
+// Swap rows with the neighbour of a link, the lower rank sends first so that blocking sockets never wait on each other
+void Domain::exchangeLink(Link& link, const uint64_t* sendRow, uint64_t* recvRow, size_t words) {
+    if (!link.active) return;
+    if (link.lower) {
+        this->sendRow(link, sendRow, words);
+        this->recvRow(link, recvRow, words);
+    } else {
+        this->recvRow(link, recvRow, words);
+        this->sendRow(link, sendRow, words);
+    }
+}
+
+// One halo exchange: first row up into the padding row of the rank above, last row down, and the other way around.
+// Even ranks start with the link below and odd ranks with the link above, so that every link of the chain is served at once.
+void Domain::exchange() {
+    uint64_t* first = grid + words;
+    uint64_t* last = grid + (size_t)(rows - 2) * words;
+    uint64_t* top = grid;
+    uint64_t* bottom = grid + (size_t)(rows - 1) * words;
+    if (rank % 2 == 0) {
+        exchangeLink(down, last, bottom, words);
+        exchangeLink(up, first, top, words);
+    } else {
+        exchangeLink(up, first, top, words);
+        exchangeLink(down, last, bottom, words);
+    }
+}
+
+// Start the halo exchange of the current grid buffer on the background thread.
+// Until waitExchange() returns, only the padding rows are written and the rows next to them must not change
+void Domain::beginExchange(uint64_t* g, int r, int w) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        grid = g;
+        rows = r;
+        words = w;
+        busy = true;
+    }
+    wake.notify_one();
+}
+
+// Wait for the halos of the current step
+void Domain::waitExchange() {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [&]{ return !busy; });
+    waitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!error.empty()) throw std::runtime_error(error);
+}
+
+// Sum of a value over every rank, the result is only complete on rank 0. No exchange must be in progress
+uint64_t Domain::sum(uint64_t value) {
+    uint64_t below = 0;
+    if (down.active) {
+        recvRow(down, &below, 1);
+        value += below;
+    }
+    if (up.active) sendRow(up, &value, 1);
+    return value;
+}
+
+// Exchange thread loop, errors are handed over to waitExchange()
+void Domain::loop() {
+    TRACE_THREAD("halo exchange");
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        wake.wait(lock, [&]{ return quit || busy; });
+        if (quit) return;
+
+        lock.unlock();
+        std::string err;
+        try {
+            TRACE_SCOPE("halo exchange");
+            exchange();
+        } catch (const std::exception& e) {
+            err = e.what();
+        }
+        lock.lock();
+
+        error = err;
+        busy = false;
+        done.notify_one();
+    }
+}
@@ -1,8 +1,11 @@
 #include "gl_wrappers.hpp"
+#include "trace.hpp"
 
 #include <utility>
 #include <stdexcept>
 #include <string>
+#include <cstring>
+#include <algorithm>
 
 GLVertexBuffer::GLVertexBuffer() {
     glGenVertexArrays(1, &id);
@@ -90,6 +93,7 @@ void GLTextureBuffer::allocate(GLenum internalFormat, GLsizeiptr sizeBytes, cons
 }
 
 void GLTextureBuffer::update(GLsizeiptr sizeBytes, const void* data, GLintptr offset) {
+    TRACE_SCOPE("texture upload");
     glBindBuffer(GL_TEXTURE_BUFFER, bufID);
     glBufferSubData(GL_TEXTURE_BUFFER, offset, sizeBytes, data);
 }
@@ -107,6 +111,40 @@ GLTextureBuffer& GLTextureBuffer::operator=(GLTextureBuffer&& other) noexcept {
     return *this;
 }
 
+GLTexture2D::GLTexture2D() {
+    glGenTextures(1, &id);
+}
+
+GLTexture2D::~GLTexture2D() {
+    if (id) glDeleteTextures(1, &id);
+}
+
+void GLTexture2D::bind(GLuint unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, id);
+}
+
+// Allocate and fill the texture, sampled as nearest texels clamped to the edges
+void GLTexture2D::allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* data) {
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+GLTexture2D::GLTexture2D(GLTexture2D&& other) noexcept
+    : id(other.id)
+{
+    other.id = 0;
+}
+
+GLTexture2D& GLTexture2D::operator=(GLTexture2D&& other) noexcept {
+    std::swap(id, other.id);
+    return *this;
+}
+
 GLProgram::GLProgram(const char* vertSrc, const char* fragSrc) {
     loadFromSource(vertSrc, fragSrc);
 }
@@ -134,6 +172,72 @@ void GLProgram::loadFromSource(const char* vertSrc, const char* fragSrc) {
         glGetProgramInfoLog(id, 512, nullptr, log);
         throw std::runtime_error(std::string("Program link error: ") + log);
     }
+
+    cacheUniforms();
+}
+
+// Resolve the locations of every active uniform once, after linking
+void GLProgram::cacheUniforms() {
+    uniforms.clear();
+    uniformNames.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buffer(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // Arrays are reported as "name[0]"
+        if (name.ends_with("[0]")) name.resize(name.size() - 3);
+
+        Uniform u;
+        u.location = glGetUniformLocation(id, name.c_str());
+        if (u.location < 0) continue;
+        uniformNames[name] = (int)uniforms.size();
+        uniforms.push_back(u);
+    }
+}
+
+int GLProgram::uniform(const std::string& name) const {
+    auto it = uniformNames.find(name);
+    return (it == uniformNames.end()) ? -1 : it->second;
+}
+
+// Compare with the last value sent and remember the new one
+bool GLProgram::changed(int handle, const void* value, size_t size) {
+    Uniform& u = uniforms[handle];
+    if (u.sent && std::memcmp(u.value, value, size) == 0) return false;
+    std::memcpy(u.value, value, size);
+    u.sent = true;
+    return true;
+}
+
+void GLProgram::setInt(int handle, int v) {
+    if (handle < 0 || !changed(handle, &v, sizeof(v))) return;
+    glUniform1i(uniforms[handle].location, v);
+}
+
+void GLProgram::setFloat(int handle, float v) {
+    if (handle < 0 || !changed(handle, &v, sizeof(v))) return;
+    glUniform1f(uniforms[handle].location, v);
+}
+
+void GLProgram::setVec2(int handle, float x, float y) {
+    float v[2] = {x, y};
+    if (handle < 0 || !changed(handle, v, sizeof(v))) return;
+    glUniform2f(uniforms[handle].location, x, y);
+}
+
+void GLProgram::setVec4(int handle, float x, float y, float z, float w) {
+    float v[4] = {x, y, z, w};
+    if (handle < 0 || !changed(handle, v, sizeof(v))) return;
+    glUniform4f(uniforms[handle].location, x, y, z, w);
 }
 
 void GLProgram::use() const {
@@ -159,12 +263,14 @@ GLuint GLProgram::compile(GLenum type, const char* src) {
 }
 
 GLProgram::GLProgram(GLProgram&& other) noexcept
-    : id(other.id)
+    : id(other.id), uniforms(std::move(other.uniforms)), uniformNames(std::move(other.uniformNames))
 {
     other.id = 0;
 }
 
 GLProgram& GLProgram::operator=(GLProgram&& other) noexcept {
     std::swap(id, other.id);
+    std::swap(uniforms, other.uniforms);
+    std::swap(uniformNames, other.uniformNames);
     return *this;
 }
\ No newline at end of file
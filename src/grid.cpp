@@ -1,9 +1,13 @@
 #include "grid.hpp"
+#include "trace.hpp"
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <bit>
 
-Grid::Grid() : rng(std::random_device{}()), uniform_dist(0, ~0ULL), bernoulli_dist(0.5) {
+Grid::Grid() {
 
 }
 
@@ -18,163 +22,577 @@ void Grid::initSeed() {
     } else {
         gridSeed = cfg->seed;
     }
-    rng.seed(gridSeed);
 }
 
 // Init size of every buffer related to grid
 void Grid::initSize() {
     rows = cfg->gridy + 2;
     words_per_row = w_for_w(cfg->gridx);
-    blocksize = 1;
-    
-    mask.resize(rows * words_per_row);
-    current.resize(rows * words_per_row);
-    next.resize(rows * words_per_row);
-    
-    mask.assign(rows * words_per_row, 0ULL);
-    current.assign(rows * words_per_row, 0ULL);
-    next.assign(rows * words_per_row, 0ULL);
 
-    count.resize(9);
+    // Reuses the arena block when the new grid fits in it
+    size_t words = (size_t)rows * words_per_row;
+    arena.reserve(words, 2);
+    current = arena.slot(0);
+    next = arena.slot(1);
+    currentSlot = 0;
+    arena.beginWrite(0);
+    arena.beginWrite(1);
+
+    initThreads();
+
+    // Zero fill by bands: each worker does the first touch of the rows it will compute, so pages land on its NUMA node
+    workers.run([&](int b) {
+        int r0 = (b == 0) ? 0 : bandStart[b];
+        int r1 = (b == workers.size() - 1) ? rows : bandStart[b + 1];
+        size_t off = (size_t)r0 * words_per_row;
+        size_t bytes = (size_t)(r1 - r0) * words_per_row * sizeof(uint64_t);
+        std::memset(current.data() + off, 0, bytes);
+        std::memset(next.data() + off, 0, bytes);
+    });
+    markAllDirty();
+    initHeat();
+}
+
+// Init worker threads and split the rows in one band per worker
+void Grid::initThreads() {
+    int n = cfg->threads > 0 ? cfg->threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+    // Avoid waking threads for small grids, each band should hold at least 2^18 cells
+    size_t cells = (size_t)(rows - 2) * words_per_row * 64;
+    n = (int)std::clamp<size_t>(cells >> 18, 1, (size_t)n);
+    n = std::min(n, std::max(1, rows - 2));
+
+    workers.init(n);
+    bandStart.resize(n + 1);
+    for (int b = 0; b <= n; ++b) {
+        bandStart[b] = 1 + (int)((size_t)(rows - 2) * b / n);
+    }
+}
+
+// Resize the grid and keep its content, either centered or anchored to the top left corner
+void Grid::resize(int gx, int gy, bool centered) {
+    int dx = centered ? (gx - cfg->gridx) / 2 : 0;
+    int dy = centered ? (gy - cfg->gridy) / 2 : 0;
+
+    // Unbounded mode: the world is untouched, only the view moves
+    if (world) {
+        cfg->gridx = gx;
+        cfg->gridy = gy;
+        initSize();
+        initMask();
+        originX -= dx;
+        originY -= dy;
+        extractWorld();
+        notify(nullptr);
+        return;
+    }
+
+    // Keep a copy of the old layout, the arena block may be reused for the new one
+    std::vector<uint64_t> old(current.begin(), current.end());
+    int oldWords = words_per_row;
+    int oldRows = rows;
+
+    cfg->gridx = gx;
+    cfg->gridy = gy;
+    rows = cfg->gridy + 2;
+    words_per_row = w_for_w(cfg->gridx);
+
+    size_t words = (size_t)rows * words_per_row;
+    arena.reserve(words, 2);
+    current = arena.slot(0);
+    next = arena.slot(1);
+    currentSlot = 0;
+    arena.beginWrite(0);
+    arena.beginWrite(1);
+    initThreads();
+    initMask();
+
+    // Bit offset in the old rows of the first bit of a new row
+    int64_t shift = -(int64_t)dx;
+
+    // Get 64 bits of an old row starting at any bit offset, outside bits are dead cells
+    auto oldBits = [&](const uint64_t* row, int64_t s) -> uint64_t {
+        int64_t q = (s >= 0) ? s / 64 : -((63 - s) / 64);
+        int o = (int)(s - q * 64);
+        uint64_t lo = (q >= 0 && q < oldWords) ? row[q] >> o : 0ULL;
+        uint64_t hi = (o && q + 1 >= 0 && q + 1 < oldWords) ? row[q + 1] << (64 - o) : 0ULL;
+        return lo | hi;
+    };
+
+    // Move the bits row by row, each worker on its own band
+    workers.run([&](int b) {
+        int r0 = (b == 0) ? 0 : bandStart[b];
+        int r1 = (b == workers.size() - 1) ? rows : bandStart[b + 1];
+        for (int r = r0; r < r1; ++r) {
+            uint64_t* cur = &current[(size_t)r * words_per_row];
+            std::memset(&next[(size_t)r * words_per_row], 0, words_per_row * sizeof(uint64_t));
+
+            // Padding rows and rows out of the old grid
+            int oldr = r - dy;
+            if (r == 0 || r == rows - 1 || oldr < 1 || oldr > oldRows - 2) {
+                std::memset(cur, 0, words_per_row * sizeof(uint64_t));
+                continue;
+            }
+
+            const uint64_t* src = &old[(size_t)oldr * oldWords];
+            for (int w = 0; w < words_per_row; ++w) {
+                cur[w] = oldBits(src, shift + (int64_t)w * 64);
+            }
+            cur[words_per_row - 1] &= tailMask;
+        }
+    });
+    markAllDirty();
+    initHeat();
+    notify(nullptr);
+}
+
+// Set the grid content back to a recorded generation, words in the current layout
+void Grid::restore(const std::vector<uint64_t>& words, uint64_t gen) {
+    arena.beginWrite(currentSlot);
+    std::copy(words.begin(), words.end(), current.begin());
+    generation = gen;
+    markAllDirty();
+    initHeat();
+}
+
+// Every row changed, for initializations and external writes to the grid
+void Grid::markAllDirty() {
+    ++version;
+    rowVersion.assign(rows, version);
+
+    // The next buffer is not known, all its rows are assumed live and get written by the next step
+    rowLive.assign(rows, 0);
+    nextRowLive.assign(rows, 1);
+    for (int r = 0; r < rows; ++r) {
+        const uint64_t* row = &current[(size_t)r * words_per_row];
+        for (int w = 0; w < words_per_row; ++w) {
+            if (row[w]) {
+                rowLive[r] = 1;
+                break;
+            }
+        }
+    }
+    nextRowLive[0] = rowLive[0];
+    nextRowLive[rows - 1] = rowLive[rows - 1];
+    publishShared();
 }
 
-// Init born and survive masks
+// Export the grid through the shared memory segment of the given name, for readers in other processes (gol_shm.h).
+// Called before initSize()
+void Grid::initShared(const std::string& name) {
+    arena.share(name);
+}
+
+// Make the current buffer the one readers of the shared memory see, nothing without export
+void Grid::publishShared() {
+    arena.publish(currentSlot, generation, cfg->gridx, cfg->gridy, rows, words_per_row);
+}
+
+// Init born and survive masks, and the lookup table of the rule when the LUT kernel is selected
 void Grid::initRuleset() {
     born_rule = cfg->born_rule;
     survive_rule = cfg->survive_rule;
+    if (world) world->setRules(born_rule, survive_rule);
+    if (cfg->kernel == "lut") {
+        initLut();
+    } else {
+        lut.clear();
+        lut.shrink_to_fit();
+    }
 }
 
-// Init grid mask
-void Grid::initMask() {
-    int pad = ((words_per_row * 64) - cfg->gridx);
-    leftpad = pad / 2;
-    int rightpad = leftpad + pad % 2;
-    for (int r = 1; r < rows-1; r++) {
-        if (words_per_row == 1) {
-            mask[r] = (~0ULL << leftpad) & (~0ULL >> rightpad);
-        } else {
-            mask[r * words_per_row] = (~0ULL << leftpad);
-            mask[r * words_per_row + words_per_row - 1] = (~0ULL >> rightpad);
-            for (int w = 1; w < words_per_row-1; w++) {
-                mask[r * words_per_row + w] = ~0ULL;
+// Build the lookup table: the index holds a 4x4 block of cells, 4 bits per row from top to bottom, bit i of a row being
+// the cell at x = i - 1 from the left cell of the center. The entry holds the next state of the 2x2 center, top row first.
+void Grid::initLut() {
+    lut.resize(1 << 16);
+    for (int idx = 0; idx < (1 << 16); ++idx) {
+        auto cell = [&](int x, int y) { return (idx >> (y * 4 + x)) & 1; };
+        uint8_t out = 0;
+        for (int y = 1; y <= 2; ++y) {
+            for (int x = 1; x <= 2; ++x) {
+                int n = cell(x-1, y-1) + cell(x, y-1) + cell(x+1, y-1)
+                      + cell(x-1, y)                  + cell(x+1, y)
+                      + cell(x-1, y+1) + cell(x, y+1) + cell(x+1, y+1);
+                uint16_t rule = cell(x, y) ? survive_rule : born_rule;
+                if (rule & (1U << n)) out |= 1 << ((y - 1) * 2 + (x - 1));
             }
         }
+        lut[idx] = out;
     }
 }
 
+// Init the mask of the last word of each row, bits past gridx are padding and must stay dead
+void Grid::initMask() {
+    int tail = cfg->gridx % 64;
+    tailMask = (tail == 0) ? ~0ULL : (~0ULL >> (64 - tail));
+}
+
 // Init the grid as a checkerboard, for debug purposes
 void Grid::initCheckerGrid() {
     uint64_t word = 0x5555555555555555;
+    arena.beginWrite(currentSlot);
 
-    for (int r = 0; r < rows; ++r) {
+    for (int r = 1; r < rows - 1; ++r) {
         for (int w = 0; w < words_per_row; ++w){
             int idx = r * words_per_row + w;
             if ((r % 2) == 0) {
-                current[idx] = word & mask[idx];
+                current[idx] = word;
             } else {
-                current[idx] = ~word & mask[idx];
+                current[idx] = ~word;
             }
         }
+        current[r * words_per_row + words_per_row - 1] &= tailMask;
     }
+    generation = 0;
+    markAllDirty();
+    initHeat();
+    if (cfg->unbounded) initWorld();
+    notify(nullptr);
 }
 
-// Init the grid as random
+// Init the grid as random. Each word is drawn from its seed and its index in the whole grid, so the result is the
+// same for any number of workers, and a stripe of a decomposed grid gets the same cells as a single process run
 void Grid::initRandomGrid() {
-    if (cfg->distType == "uniform") {
-        for (size_t i = 0; i < current.size(); ++i) {
-            current[i] = uniform_dist(rng) & mask[i];
-        }
-    } else if (cfg->distType == "bernoulli") {
-        bernoulli_dist = std::bernoulli_distribution(cfg->density);
-        uint64_t word = 0ULL;
-        for (size_t i = 0; i < current.size(); ++i) {
-            word = 0ULL;
-            for (int bit = 0; bit < 64; ++bit) {
-                if (bernoulli_dist(rng)) word |= (1ULL << bit);
+    bool uniform = (cfg->distType == "uniform");
+    if (!uniform && cfg->distType != "bernoulli") throw std::runtime_error("[Fatal] Bad type error: " + cfg->distType);
+
+    uint64_t key = (uint32_t)gridSeed;
+    double density = cfg->density;
+    int64_t rowOffset = domain ? domain->firstRow : 0;
+    arena.beginWrite(currentSlot);
+
+    // Only the inner rows are filled, padding rows stay dead
+    workers.run([&](int b) {
+        for (int r = bandStart[b]; r < bandStart[b + 1]; ++r) {
+            uint64_t index = (uint64_t)(rowOffset + r - 1) * words_per_row;
+            uint64_t* row = current.data() + (size_t)r * words_per_row;
+            for (int w = 0; w < words_per_row; ++w) {
+                row[w] = uniform ? philox_word(key, index + w, 0) : philox_bernoulli(key, index + w, density);
             }
-            current[i] = word & mask[i];
         }
+    });
+    for (int r = 1; r < rows - 1; ++r) {
+        current[r * words_per_row + words_per_row - 1] &= tailMask;
+    }
+    generation = 0;
+    markAllDirty();
+    initHeat();
+    if (cfg->unbounded) initWorld();
+    notify(nullptr);
+}
+
+// Init the unbounded world from the current grid content, the grid becomes a view on the world
+void Grid::initWorld() {
+    if (!world) world = std::make_unique<SparseWorld>();
+    world->clear();
+    world->setRules(born_rule, survive_rule);
+    originX = 0;
+    originY = 0;
+    for (int r = 1; r < rows - 1; ++r) {
+        for (int w = 0; w < words_per_row; ++w) {
+            world->orWord(originX + w * 64, originY + r - 1, current[r * words_per_row + w]);
+        }
+    }
+}
+
+// Allocate the heat map when enabled, every cell starts cold (saturated age), or release it when disabled
+void Grid::initHeat() {
+    if (cfg->heatmap) {
+        heat.assign((size_t)rows * words_per_row * 4, ~0ULL);
     } else {
-        throw std::runtime_error("[Fatal] Bad type error: " + cfg->distType);
+        heat.clear();
+        heat.shrink_to_fit();
     }
 }
 
+// Copy the part of the world under the grid view into the current buffer
+void Grid::extractWorld(bool trackHeat) {
+    trackHeat = trackHeat && !heat.empty();
+    arena.beginWrite(currentSlot);
+    for (int r = 1; r < rows - 1; ++r) {
+        for (int w = 0; w < words_per_row; ++w) {
+            uint64_t word = world->getWord(originX + w * 64, originY + r - 1);
+            if (w == words_per_row - 1) word &= tailMask;
+            size_t i = (size_t)r * words_per_row + w;
+            if (trackHeat) age_word(&heat[i * 4], word ^ current[i]);
+            current[i] = word;
+        }
+    }
+    markAllDirty();
+}
+
 // Step function
 void Grid::step() {
-    // Loop by row blocks for future multithread, currently the blocksize is locked to one, so this loop is neutral
-    for (int rb = 1; rb < rows - 1; rb += blocksize) {
-        int rend = std::min(rows - 1, rb + blocksize);
-        for (int r = rb; r < rend; ++r) {
-            // Load top, mid (current) and bottom rows, mask row and out buffer pointers
-            const uint64_t* top = &current[(r-1)*words_per_row];
-            const uint64_t* mid = &current[r*words_per_row];
-            const uint64_t* bot = &current[(r+1)*words_per_row];
-            const uint64_t* row_mask = &mask[r*words_per_row];
-            uint64_t* out = &next[r*words_per_row];
-
-            // Loop through each word of the rows, and shifting in each direction to get Moore's neighborhood
-            for (int w = 0; w < words_per_row; ++w) {
-                uint64_t top_left  = (top[w] << 1) | (w>0 ? top[w-1] >> 63 : 0);
-                uint64_t top_mid   = top[w];
-                uint64_t top_right = (top[w] >> 1) | (w<words_per_row-1 ? top[w+1] << 63 : 0);
-
-                uint64_t mid_left  = (mid[w] << 1) | (w>0 ? mid[w-1] >> 63 : 0);
-                uint64_t mid_right = (mid[w] >> 1) | (w<words_per_row-1 ? mid[w+1] << 63 : 0);
-
-                uint64_t bot_left  = (bot[w] << 1) | (w>0 ? bot[w-1] >> 63 : 0);
-                uint64_t bot_mid   = bot[w];
-                uint64_t bot_right = (bot[w] >> 1) | (w<words_per_row-1 ? bot[w+1] << 63 : 0);
-
-                // Bitwise adder
-                uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
-                uint64_t c1 = 0, c2 = 0;
-
-                c1 = s0 & top_left; s0 ^= top_left; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & top_mid;  s0 ^= top_mid;  c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & top_right; s0 ^= top_right; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & mid_left; s0 ^= mid_left; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & mid_right; s0 ^= mid_right; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & bot_left; s0 ^= bot_left; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & bot_mid; s0 ^= bot_mid; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-                c1 = s0 & bot_right; s0 ^= bot_right; c2 = s1 & c1; s1 ^= c1; s3 ^= s2 & c2; s2 ^= c2;
-
-                // Count buffer: 0 to 8 neighboors for each cell of the current word
-                count[0] = ~s3 & ~s2 & ~s1 & ~s0;
-                count[1] = ~s3 & ~s2 & ~s1 & s0;
-                count[2] = ~s3 & ~s2 & s1 & ~s0;
-                count[3] = ~s3 & ~s2 & s1 & s0;
-                count[4] = ~s3 & s2 & ~s1 & ~s0;
-                count[5] = ~s3 & s2 & ~s1 & s0;
-                count[6] = ~s3 & s2 & s1 & ~s0;
-                count[7] = ~s3 & s2 & s1 & s0;
-                count[8] = s3 & ~s2 & ~s1 & ~s0;
-
-                // Set born and survive masks for the word
-                uint64_t born = 0ULL, survive = 0ULL;
-
-                // Compute the born and survive condition given the count buffer and the born and survive rules
-                for (int i = 0; i < 9; ++i) {
-                    if (born_rule & (1U << i)) born |= count[i];
-                    if (survive_rule & (1U << i)) survive |= count[i];
-                }
-
-                // Final output with born and survive conditions, given the current state of the cells and the mask
-                out[w] = (born | (mid[w] & survive)) & row_mask[w];
-            }
+    TRACE_SCOPE("step");
+    // Unbounded mode: the world evolves on its own and the grid is only a view on it
+    if (world) {
+        world->step();
+        ++generation;
+        extractWorld(true);
+        notify(nullptr);
+        return;
+    }
+
+    // Changed words are collected by part of the rows, in row order: top halo row, bands, bottom halo row
+    bool track = !listeners.empty();
+    if (track) {
+        partRuns.resize(workers.size() + 2);
+        for (auto& p : partRuns) p.clear();
+    }
+
+    // Readers of the shared memory still holding the generation before the current one have to retry
+    arena.beginWrite(currentSlot ^ 1);
+
+    if (domain) {
+        // The padding rows are not known before the exchange, they never let their neighbours be skipped
+        rowLive[0] = rowLive[rows - 1] = 1;
+        // The halos are exchanged while the inner rows are computed, the first and last rows wait for them
+        domain->beginExchange(current.data(), rows, words_per_row);
+        stepBands(2, rows - 2);
+        {
+            TRACE_SCOPE("halo wait");
+            domain->waitExchange();
         }
+        stepRange(1, 2, track ? &partRuns.front() : nullptr);
+        stepRange(std::max(2, rows - 2), rows - 1, track ? &partRuns.back() : nullptr);
+    } else {
+        stepBands(1, rows - 1);
     }
+    ++version;
+    ++generation;
     // Swap current and next buffers
     std::swap(current, next);
+    std::swap(rowLive, nextRowLive);
+    currentSlot ^= 1;
+    publishShared();
+    if (track) {
+        mergeChanges();
+        notify(&changes);
+    }
 }
 
-// Get raw grid content
-std::vector<uint64_t> Grid::getGrid() {
-    return current;
+// Step of the rows [r0, r1) on the workers, each one computes the part of its own band in the range
+void Grid::stepBands(int r0, int r1) {
+    bool track = !listeners.empty();
+    workers.run([&](int b) {
+        TRACE_SCOPE("step band");
+        stepRange(std::max(r0, bandStart[b]), std::min(r1, bandStart[b + 1]), track ? &partRuns[b + 1] : nullptr);
+    });
+}
+
+// Step of the rows [r0, r1) with the selected kernel, the heat map version only when enabled
+void Grid::stepRange(int r0, int r1, ChangeRuns* runs) {
+    if (r0 >= r1) return;
+    if (lut.empty()) {
+        if (heat.empty()) stepRows<false>(r0, r1, runs);
+        else stepRows<true>(r0, r1, runs);
+    } else {
+        if (heat.empty()) stepRowsLut<false>(r0, r1, runs);
+        else stepRowsLut<true>(r0, r1, runs);
+    }
+}
+
+// Join the runs of every part in a single run-length list
+void Grid::mergeChanges() {
+    changes.generation = generation;
+    changes.words = 0;
+    changes.runs.clear();
+    uint64_t pos = 0;
+    for (const auto& p : partRuns) {
+        size_t i = 0;
+        while (i < p.data.size()) {
+            uint64_t start = p.data[i];
+            uint64_t count = p.data[i + 1];
+            // Gaps are stored on 32 bits, longer ones are split in runs without changed words
+            uint64_t gap = start - pos;
+            while (gap > 0xFFFFFFFFULL) {
+                changes.runs.push_back(0xFFFFFFFFULL << 32);
+                gap -= 0xFFFFFFFFULL;
+            }
+            changes.runs.push_back((gap << 32) | count);
+            changes.runs.insert(changes.runs.end(), p.data.begin() + i + 2, p.data.begin() + i + 2 + count);
+            changes.words += count;
+            pos = start + count;
+            i += 2 + count;
+        }
+    }
+}
+
+// Register a listener of the grid changes
+void Grid::addListener(std::function<void(const ChangeList*)> fn) {
+    listeners.push_back(std::move(fn));
+}
+
+// Call every listener
+void Grid::notify(const ChangeList* list) {
+    for (const auto& fn : listeners) fn(list);
+}
+
+// Step of a row with no live cell around: it stays empty. Its next row is only cleared when it may hold live cells,
+// the heat map still ages its cells
+void Grid::skipRow(int r) {
+    if (nextRowLive[r]) {
+        std::memset(&next[(size_t)r * words_per_row], 0, words_per_row * sizeof(uint64_t));
+        nextRowLive[r] = 0;
+    }
+    if (!heat.empty()) {
+        uint64_t* age = &heat[(size_t)r * words_per_row * 4];
+        for (int w = 0; w < words_per_row; ++w) age_word(age + w * 4, 0ULL);
+    }
+}
+
+// Step of the rows [r0, r1), with the heat map update when Heat is set. Changed words are added to runs when given
+template<bool Heat>
+void Grid::stepRows(int r0, int r1, ChangeRuns* runs) {
+    // Empty space stays empty unless the rule has B0
+    const bool skip = !(born_rule & 1);
+    for (int r = r0; r < r1; ++r) {
+        if (skip && !(rowLive[r-1] | rowLive[r] | rowLive[r+1])) {
+            skipRow(r);
+            continue;
+        }
+
+        // Load top, mid (current) and bottom rows and out buffer pointers
+        const uint64_t* top = &current[(r-1)*words_per_row];
+        const uint64_t* mid = &current[r*words_per_row];
+        const uint64_t* bot = &current[(r+1)*words_per_row];
+        uint64_t* out = &next[r*words_per_row];
+        uint64_t* age = Heat ? &heat[(size_t)r * words_per_row * 4] : nullptr;
+        const int last = words_per_row - 1;
+
+        // Single word rows have no neighbour word at all
+        if (last == 0) {
+            out[0] = next_word(0, top[0], 0, 0, mid[0], 0, 0, bot[0], 0, born_rule, survive_rule) & tailMask;
+            if constexpr (Heat) age_word(age, out[0] ^ mid[0]);
+            if (out[0] ^ mid[0]) rowVersion[r] = version + 1;
+            if (runs && (out[0] ^ mid[0])) runs->add((size_t)r * words_per_row, out[0] ^ mid[0]);
+            nextRowLive[r] = out[0] != 0;
+            continue;
+        }
+
+        // Changed bits of the row, for dirty tracking, and live bits for the row summary
+        uint64_t changed = 0ULL;
+        uint64_t live = 0ULL;
+
+        // First word: the missing left neighbour word is the dead border
+        out[0] = next_word(0, top[0], top[1], 0, mid[0], mid[1], 0, bot[0], bot[1], born_rule, survive_rule);
+        if constexpr (Heat) age_word(age, out[0] ^ mid[0]);
+        changed |= out[0] ^ mid[0];
+        live |= out[0];
+        if (runs && (out[0] ^ mid[0])) runs->add((size_t)r * words_per_row, out[0] ^ mid[0]);
+
+        // Inner words, branch free
+        for (int w = 1; w < last; ++w) {
+            out[w] = next_word(top[w-1], top[w], top[w+1], mid[w-1], mid[w], mid[w+1], bot[w-1], bot[w], bot[w+1], born_rule, survive_rule);
+            if constexpr (Heat) age_word(age + w * 4, out[w] ^ mid[w]);
+            changed |= out[w] ^ mid[w];
+            live |= out[w];
+            if (runs && (out[w] ^ mid[w])) runs->add((size_t)r * words_per_row + w, out[w] ^ mid[w]);
+        }
+
+        // Last word: the missing right neighbour word is the dead border, padding bits are cleared
+        out[last] = next_word(top[last-1], top[last], 0, mid[last-1], mid[last], 0, bot[last-1], bot[last], 0, born_rule, survive_rule) & tailMask;
+        if constexpr (Heat) age_word(age + last * 4, out[last] ^ mid[last]);
+        changed |= out[last] ^ mid[last];
+        live |= out[last];
+        if (runs && (out[last] ^ mid[last])) runs->add((size_t)r * words_per_row + last, out[last] ^ mid[last]);
+
+        if (changed) rowVersion[r] = version + 1;
+        nextRowLive[r] = live != 0;
+    }
 }
 
-// Get the mask
-std::vector<uint64_t> Grid::getMask() {
-    return mask;
+// Step of the rows [r0, r1) with the lookup table, two rows at a time: each entry gives 2x2 cells of the next generation.
+// A last row without pair is computed alone, only the top half of its entries is used.
+template<bool Heat>
+void Grid::stepRowsLut(int r0, int r1, ChangeRuns* runs) {
+    const int last = words_per_row - 1;
+    const bool skip = !(born_rule & 1);
+    for (int r = r0; r < r1; r += 2) {
+        bool pair = r + 1 < r1;
+        // The blocks of a pair read the rows r-1 to r+2
+        if (skip && !(rowLive[r-1] | rowLive[r] | rowLive[r+1] | (pair ? rowLive[r+2] : 0))) {
+            skipRow(r);
+            if (pair) skipRow(r + 1);
+            continue;
+        }
+        const uint64_t* in[4] = {
+            &current[(size_t)(r-1)*words_per_row],
+            &current[(size_t)r*words_per_row],
+            &current[(size_t)(r+1)*words_per_row],
+            &current[(size_t)(pair ? r+2 : r+1)*words_per_row]
+        };
+        uint64_t* out0 = &next[(size_t)r*words_per_row];
+        uint64_t* out1 = pair ? &next[(size_t)(r+1)*words_per_row] : nullptr;
+        uint64_t changed0 = 0ULL, changed1 = 0ULL;
+        uint64_t live0 = 0ULL, live1 = 0ULL;
+
+        for (int w = 0; w <= last; ++w) {
+            // Rows shifted by one cell: bit i of lo is the cell at x = 64w + i - 1, bits 0 and 1 of hi the cells at 64w + 63 and 64w + 64
+            uint64_t lo[4], hi[4];
+            for (int k = 0; k < 4; ++k) {
+                uint64_t left = (w > 0) ? in[k][w-1] : 0ULL;
+                uint64_t right = (w < last) ? in[k][w+1] : 0ULL;
+                lo[k] = (in[k][w] << 1) | (left >> 63);
+                hi[k] = (in[k][w] >> 63) | (right << 1);
+            }
+
+            uint64_t a = 0ULL, b = 0ULL;
+            for (int j = 0; j < 31; ++j) {
+                int s = 2 * j;
+                unsigned idx = (unsigned)((lo[0] >> s) & 15) | (unsigned)((lo[1] >> s) & 15) << 4
+                             | (unsigned)((lo[2] >> s) & 15) << 8 | (unsigned)((lo[3] >> s) & 15) << 12;
+                uint64_t v = lut[idx];
+                a |= (v & 3) << s;
+                b |= (v >> 2) << s;
+            }
+            // Last pair of cells, its block spans the next word
+            unsigned idx = 0;
+            for (int k = 0; k < 4; ++k) {
+                idx |= (unsigned)((lo[k] >> 62) | ((hi[k] & 3) << 2)) << (4 * k);
+            }
+            uint64_t v = lut[idx];
+            a |= (v & 3) << 62;
+            b |= (v >> 2) << 62;
+
+            if (w == last) {
+                a &= tailMask;
+                b &= tailMask;
+            }
+            out0[w] = a;
+            changed0 |= a ^ in[1][w];
+            live0 |= a;
+            if constexpr (Heat) age_word(&heat[((size_t)r * words_per_row + w) * 4], a ^ in[1][w]);
+            if (pair) {
+                out1[w] = b;
+                changed1 |= b ^ in[2][w];
+                live1 |= b;
+                if constexpr (Heat) age_word(&heat[((size_t)(r+1) * words_per_row + w) * 4], b ^ in[2][w]);
+            }
+        }
+
+        if (changed0) rowVersion[r] = version + 1;
+        if (changed1) rowVersion[r + 1] = version + 1;
+        nextRowLive[r] = live0 != 0;
+        if (pair) nextRowLive[r + 1] = live1 != 0;
+
+        // Both rows are computed word after word, their changes are listed row after row
+        if (runs && changed0) {
+            for (int w = 0; w <= last; ++w) {
+                if (out0[w] ^ in[1][w]) runs->add((size_t)r * words_per_row + w, out0[w] ^ in[1][w]);
+            }
+        }
+        if (runs && changed1) {
+            for (int w = 0; w <= last; ++w) {
+                if (out1[w] ^ in[2][w]) runs->add((size_t)(r+1) * words_per_row + w, out1[w] ^ in[2][w]);
+            }
+        }
+    }
+}
+
+// Get raw grid content
+std::vector<uint64_t> Grid::getGrid() {
+    return std::vector<uint64_t>(current.begin(), current.end());
 }
 
 // Get the grid as a uint32_t recast for texture rendering
@@ -182,16 +600,34 @@ const uint32_t* Grid::getGrid32Ptr() const {
     return reinterpret_cast<const uint32_t*>(current.data());
 }
 
-// Function to print the mask, for debug purposes
-void Grid::printMask() {
-    for (int r = 0; r < rows; ++r) {
-        for (int w = 0; w < words_per_row; ++w) {
-            for (int b = 0; b < 64; ++b) {
-                std::cout << (mask[r * words_per_row + w] & (1ULL << b) ? '#' : '.');
-            }
-        }
-        std::cout << "\n";
+// Get the raw grid words without copy
+const uint64_t* Grid::getGridPtr() const {
+    return current.data();
+}
+
+// Get the heat map planes, nullptr when disabled
+const uint64_t* Grid::getHeatPtr() const {
+    return heat.empty() ? nullptr : heat.data();
+}
+
+// Number of live cells of the grid, or of the whole world in unbounded mode
+uint64_t Grid::population() const {
+    if (world) return world->population();
+    uint64_t pop = 0;
+    for (size_t i = words_per_row; i < (size_t)(rows - 1) * words_per_row; ++i) {
+        pop += std::popcount(current[i]);
+    }
+    return pop;
+}
+
+// Hash of the grid content, equal hashes mark repeated generations
+uint64_t Grid::hash() const {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = words_per_row; i < (size_t)(rows - 1) * words_per_row; ++i) {
+        h = (h ^ current[i]) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
     }
+    return h;
 }
 
 // Function to print the grid, for debug purposes
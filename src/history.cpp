@@ -0,0 +1,268 @@
+#include "history.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+
+History::History() {
+
+}
+
+History::~History() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+// Set the memory budget and the keyframe interval, start the background thread. Can be called again while recording
+void History::init(size_t budgetBytes, int interval) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        budget = budgetBytes;
+        evict();
+    }
+    keyInterval = std::max(1, interval);
+    if (!worker.joinable()) worker = std::thread(&History::loop, this);
+}
+
+// Hand a copy of the grid over to the background thread, or only the changed words when the step gives them.
+// Called after each step and each change of the pattern
+void History::record(const Grid& grid, const ChangeList* changes) {
+    // The unbounded world is not recorded, only its view would be
+    if (grid.world) return;
+
+    size_t size = (size_t)grid.rows * grid.words_per_row;
+    bool reset = !recorded || size != lastSize || grid.generation <= lastGeneration;
+    bool key = reset || gap || grid.generation != lastGeneration + 1;
+
+    // The changes of a step are already a run-length encoded delta with the previous generation
+    bool delta = changes && !key;
+
+    Snapshot snap;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        // Encoding is late: drop the snapshot, the next one will be a keyframe
+        if (pending.size() >= maxPending) {
+            gap = true;
+            return;
+        }
+        if (!spare.empty() && !delta) {
+            snap.words = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    if (delta) {
+        snap.delta = true;
+        snap.runs = changes->runs;
+    } else {
+        const uint64_t* data = grid.getGridPtr();
+        snap.words.assign(data, data + size);
+    }
+    snap.generation = grid.generation;
+    snap.key = key;
+    snap.reset = reset;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending.push_back(std::move(snap));
+    }
+    wake.notify_one();
+
+    recorded = true;
+    gap = false;
+    lastGeneration = grid.generation;
+    lastSize = size;
+}
+
+// Background thread: encode the snapshots in order
+void History::loop() {
+    TRACE_THREAD("history");
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        wake.wait(lock, [&] { return quit || !pending.empty(); });
+        if (quit) return;
+
+        Snapshot snap = std::move(pending.front());
+        pending.pop_front();
+        busy = true;
+        lock.unlock();
+
+        {
+            TRACE_SCOPE("history encode");
+            store(snap);
+        }
+
+        lock.lock();
+        if (snap.words.capacity()) spare.push_back(std::move(snap.words));
+        busy = false;
+        if (pending.empty()) idle.notify_all();
+    }
+}
+
+// Encode a snapshot as a keyframe or as a delta with the previous generation
+void History::store(Snapshot& snap) {
+    Frame frame;
+    frame.generation = snap.generation;
+    frame.key = snap.key || sinceKey >= keyInterval || (!snap.delta && last.size() != snap.words.size());
+    if (frame.key) sinceKey = 0;
+
+    if (snap.delta) {
+        // The base moves to this generation with the changes alone, the full grid is only encoded for keyframes
+        decodeXor(snap.runs, last);
+        if (frame.key) encode(last.data(), last.size(), frame.rle);
+        else frame.rle = std::move(snap.runs);
+    } else if (frame.key) {
+        encode(snap.words.data(), snap.words.size(), frame.rle);
+    } else {
+        delta.resize(snap.words.size());
+        for (size_t i = 0; i < delta.size(); ++i) {
+            delta[i] = snap.words[i] ^ last[i];
+        }
+        encode(delta.data(), delta.size(), frame.rle);
+    }
+    ++sinceKey;
+
+    // The snapshot becomes the base of the next delta, the old base goes back to the spare buffers
+    if (!snap.delta) last.swap(snap.words);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (snap.reset) {
+        frames.clear();
+        bytes = 0;
+    }
+    bytes += frame.rle.size() * sizeof(uint64_t);
+    frames.push_back(std::move(frame));
+    evict();
+}
+
+// Drop the oldest keyframe groups until the budget is met, the newest group is always kept
+void History::evict() {
+    while (bytes > budget) {
+        size_t next = 1;
+        while (next < frames.size() && !frames[next].key) ++next;
+        if (next >= frames.size()) return;
+        for (size_t i = 0; i < next; ++i) {
+            bytes -= frames.front().rle.size() * sizeof(uint64_t);
+            frames.pop_front();
+        }
+    }
+}
+
+// Wait until every recorded snapshot is encoded
+void History::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock, [&] { return pending.empty() && !busy; });
+}
+
+// Step the grid back by one generation, false if that generation is not in the history
+bool History::rewind(Grid& grid) {
+    if (grid.world || grid.generation == 0 || !recorded) return false;
+    flush();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    uint64_t target = grid.generation - 1;
+    if (frames.empty() || frames.back().generation != grid.generation) return false;
+
+    std::vector<uint64_t> state(lastSize, 0ULL);
+    if (!reconstruct(target, state)) return false;
+
+    // The history now ends at the target generation
+    while (!frames.empty() && frames.back().generation > target) {
+        bytes -= frames.back().rle.size() * sizeof(uint64_t);
+        frames.pop_back();
+    }
+    sinceKey = 0;
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        ++sinceKey;
+        if (it->key) break;
+    }
+    last = state;
+    lastGeneration = target;
+
+    grid.restore(state, target);
+    return true;
+}
+
+// Index of a generation in the frames, frames.size() if not stored. Generations are increasing, with holes
+// where snapshots were dropped
+size_t History::findFrame(uint64_t generation) const {
+    auto it = std::lower_bound(frames.begin(), frames.end(), generation,
+        [](const Frame& f, uint64_t g) { return f.generation < g; });
+    if (it == frames.end() || it->generation != generation) return frames.size();
+    return (size_t)(it - frames.begin());
+}
+
+// Decode a generation: its keyframe, then every delta up to it. A hole is always followed by a keyframe
+bool History::reconstruct(uint64_t generation, std::vector<uint64_t>& out) {
+    size_t idx = findFrame(generation);
+    if (idx >= frames.size()) return false;
+
+    size_t k = idx;
+    while (k > 0 && !frames[k].key) --k;
+    if (!frames[k].key) return false;
+
+    for (size_t i = k; i <= idx; ++i) {
+        decodeXor(frames[i].rle, out);
+    }
+    return true;
+}
+
+// Run-length encoding: a header word (zero words << 32 | literal words) followed by the literal words
+void History::encode(const uint64_t* words, size_t size, std::vector<uint64_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < size) {
+        size_t z = i;
+        while (z < size && words[z] == 0ULL) ++z;
+        size_t l = z;
+        while (l < size && words[l] != 0ULL) ++l;
+        out.push_back(((uint64_t)(z - i) << 32) | (uint64_t)(l - z));
+        out.insert(out.end(), words + z, words + l);
+        i = l;
+    }
+}
+
+// Decode a run-length encoded frame and XOR it into out
+void History::decodeXor(const std::vector<uint64_t>& rle, std::vector<uint64_t>& out) {
+    size_t pos = 0;
+    size_t j = 0;
+    while (j < rle.size()) {
+        uint64_t header = rle[j++];
+        pos += header >> 32;
+        uint64_t literals = header & 0xFFFFFFFFULL;
+        for (uint64_t n = 0; n < literals; ++n) {
+            out[pos++] ^= rle[j++];
+        }
+    }
+}
+
+// Number of stored generations
+size_t History::frameCount() {
+    flush();
+    std::lock_guard<std::mutex> lock(mtx);
+    return frames.size();
+}
+
+// Number of stored keyframes, about one every keyframe_interval generations
+size_t History::keyframeCount() {
+    flush();
+    std::lock_guard<std::mutex> lock(mtx);
+    return (size_t)std::count_if(frames.begin(), frames.end(), [](const Frame& f) { return f.key; });
+}
+
+// Memory used by the encoded generations
+size_t History::memoryBytes() {
+    flush();
+    std::lock_guard<std::mutex> lock(mtx);
+    return bytes;
+}
+
+// Oldest generation that can be rewound to
+uint64_t History::oldestGeneration() {
+    flush();
+    std::lock_guard<std::mutex> lock(mtx);
+    return frames.empty() ? 0 : frames.front().generation;
+}
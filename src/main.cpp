@@ -3,13 +3,13 @@
 #include <iostream>
 #include <cstdlib>
 
-int main() {
+int main(int argc, char** argv) {
 
     Application app;
 
     try {
 
-        app.run();
+        app.run(argc, argv);
 
     } catch(const std::exception& e) {
 
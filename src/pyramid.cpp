@@ -0,0 +1,129 @@
+#include "pyramid.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Live cells of each byte of a word, one count per byte
+static inline uint64_t byte_popcount(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    return (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+}
+
+DensityPyramid::DensityPyramid() {
+
+}
+
+DensityPyramid::~DensityPyramid() {
+
+}
+
+// Allocate the levels for a grid size, every block is dirty
+void DensityPyramid::init(const Grid* grid, int gridx, int gridy) {
+    this->grid = grid;
+    this->gridx = gridx;
+    this->gridy = gridy;
+    seenVersion = 0;
+
+    int count = maxLevel - baseLevel + 1;
+    levels.resize(count);
+    dirty.resize(count);
+    widths.resize(count);
+    heights.resize(count);
+    for (int i = 0; i < count; ++i) {
+        int k = baseLevel + i;
+        widths[i] = (gridx + (1 << k) - 1) >> k;
+        heights[i] = (gridy + (1 << k) - 1) >> k;
+        levels[i].assign((size_t)widths[i] * heights[i], 0);
+        dirty[i].assign(heights[i], 1);
+    }
+}
+
+// Bring the levels up to the given one in line with the grid, only dirty block rows are recomputed
+void DensityPyramid::update(int level) {
+    level = std::clamp(level, baseLevel, maxLevel);
+    updateBase();
+    for (int k = baseLevel + 1; k <= level; ++k) {
+        updateLevel(k);
+    }
+}
+
+// Base level: 8x8 blocks are counted a byte at a time, a row word holds 8 blocks
+void DensityPyramid::updateBase() {
+    int wpr = grid->words_per_row;
+    const uint64_t* data = grid->getGridPtr();
+    std::vector<uint16_t>& base = levels[0];
+    std::vector<uint8_t>& baseDirty = dirty[0];
+    int width = widths[0];
+
+    // Block rows holding a row changed since the last update
+    for (int y = 0; y < gridy; ++y) {
+        if (grid->rowVersion[y + 1] > seenVersion) baseDirty[y >> baseLevel] = 1;
+    }
+    seenVersion = grid->version;
+
+    for (int j = 0; j < heights[0]; ++j) {
+        if (!baseDirty[j]) continue;
+        baseDirty[j] = 0;
+
+        // Upper levels are dirty above this block row
+        for (size_t i = 1; i < dirty.size(); ++i) {
+            dirty[i][j >> i] = 1;
+        }
+
+        int y0 = j << baseLevel;
+        int y1 = std::min(y0 + (1 << baseLevel), gridy);
+        uint16_t* out = &base[(size_t)j * width];
+        for (int w = 0; w < wpr; ++w) {
+            // At most 64 cells per byte lane, no carry between lanes
+            uint64_t acc = 0ULL;
+            for (int y = y0; y < y1; ++y) {
+                acc += byte_popcount(data[(size_t)(y + 1) * wpr + w]);
+            }
+            int bx0 = w * 8;
+            int bx1 = std::min(bx0 + 8, width);
+            for (int bx = bx0; bx < bx1; ++bx) {
+                out[bx] = (uint16_t)((acc >> ((bx - bx0) * 8)) & 0xFF);
+            }
+        }
+    }
+}
+
+// Upper level: each count is the sum of four blocks of the level below
+void DensityPyramid::updateLevel(int level) {
+    int i = level - baseLevel;
+    const std::vector<uint16_t>& src = levels[i - 1];
+    std::vector<uint16_t>& dst = levels[i];
+    int sw = widths[i - 1];
+    int sh = heights[i - 1];
+    int dw = widths[i];
+
+    for (int j = 0; j < heights[i]; ++j) {
+        if (!dirty[i][j]) continue;
+        dirty[i][j] = 0;
+
+        const uint16_t* top = &src[(size_t)(2 * j) * sw];
+        const uint16_t* bot = (2 * j + 1 < sh) ? top + sw : nullptr;
+        uint16_t* out = &dst[(size_t)j * dw];
+        for (int x = 0; x < dw; ++x) {
+            int x0 = 2 * x;
+            int x1 = std::min(x0 + 1, sw - 1);
+            uint32_t sum = top[x0] + (x1 != x0 ? top[x1] : 0);
+            if (bot) sum += bot[x0] + (x1 != x0 ? bot[x1] : 0);
+            out[x] = (uint16_t)sum;
+        }
+    }
+}
+
+// Counts of a level, row major, levelWidth(level) counts per row
+const std::vector<uint16_t>& DensityPyramid::getLevel(int level) const {
+    return levels[level - baseLevel];
+}
+
+int DensityPyramid::levelWidth(int level) const {
+    return widths[level - baseLevel];
+}
+
+int DensityPyramid::levelHeight(int level) const {
+    return heights[level - baseLevel];
+}
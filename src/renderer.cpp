@@ -1,7 +1,9 @@
 #include "renderer.hpp"
 #include "shaders_sources.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 
 
@@ -13,7 +15,25 @@ Renderer::Renderer(const Grid* grid, const Config* cfg) {
     vao = std::make_unique<GLVertexBuffer>();
     vbo = std::make_unique<GLBuffer>(GL_ARRAY_BUFFER);
     texture = std::make_unique<GLTextureBuffer>();
+    lodTexture = std::make_unique<GLTextureBuffer>();
+    heatTexture = std::make_unique<GLTextureBuffer>();
     shaders = std::make_unique<GLProgram>(mainVert, mainFrag);
+
+    // Uniform handles are resolved once, values are only sent when they change
+    uPackedGrid = shaders->uniform("packedGrid");
+    uLodGrid    = shaders->uniform("lodGrid");
+    uLodLevel   = shaders->uniform("lodLevel");
+    uLodWidth   = shaders->uniform("lodWidth");
+    uWindowSize = shaders->uniform("windowSize");
+    uGridSize   = shaders->uniform("gridSize");
+    uWinRow0    = shaders->uniform("winRow0");
+    uWinRows    = shaders->uniform("winRows");
+    uWinWord0   = shaders->uniform("winWord0");
+    uWinWords   = shaders->uniform("winWords");
+    uZoom       = shaders->uniform("zoom");
+    uCamera     = shaders->uniform("camera");
+    uHeatGrid   = shaders->uniform("heatGrid");
+    uHeatmap    = shaders->uniform("heatmap");
 }
 
 void Renderer::initRender() {
@@ -55,24 +75,140 @@ void Renderer::initRender() {
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    texture->allocate(GL_RG32UI, grid->rows * grid->words_per_row * sizeof(uint32_t) * 2, grid->getGrid32Ptr());
+    // The texture is allocated on the first upload, to the size of the visible window
+    textureBytes = 0;
+    heatBytes = 0;
+
+    pyramid.init(grid, cfg->gridx, cfg->gridy);
+    lodBytes = 0;
+}
+
+// Pyramid level matching the number of cells under a pixel, 0 when cells are drawn one by one
+int Renderer::selectLevel() const {
+    float cellsPerPixel = std::max((float)cfg->gridx / cfg->width, (float)cfg->gridy / cfg->height) / zoom;
+    if (cellsPerPixel < (float)(1 << DensityPyramid::baseLevel)) return 0;
+    int level = (int)std::floor(std::log2(cellsPerPixel));
+    return std::min(level, DensityPyramid::maxLevel);
+}
+
+// Compute the window of the grid seen through the camera, the same mapping as the fragment shader
+void Renderer::updateWindow() {
+    float W = (float)cfg->width;
+    float H = (float)cfg->height;
+    float windowAspect = W / H;
+    float gridAspect   = (float)cfg->gridx / (float)cfg->gridy;
+    float scaleX = (windowAspect > gridAspect) ? windowAspect / gridAspect : 1.0f;
+    float scaleY = (windowAspect > gridAspect) ? 1.0f : gridAspect / windowAspect;
+
+    // Corrected fragment coordinates at the window edges
+    float cx0 = 0.5f * W - 0.5f * W * scaleX;
+    float cx1 = 0.5f * W + 0.5f * W * scaleX;
+    float cy0 = 0.5f * H - 0.5f * H * scaleY;
+    float cy1 = 0.5f * H + 0.5f * H * scaleY;
+
+    float gx0 = camX + (cx0 - 0.5f) * ((float)cfg->gridx / W) / zoom;
+    float gx1 = camX + (cx1 - 0.5f) * ((float)cfg->gridx / W) / zoom;
+    float gy0 = cfg->gridy - (camY + (cy1 + 0.5f) * ((float)cfg->gridy / H) / zoom);
+    float gy1 = cfg->gridy - (camY + (cy0 + 0.5f) * ((float)cfg->gridy / H) / zoom);
+
+    // One word and two rows of margin against rounding, clamped to the grid
+    int w0 = std::clamp((int)std::floor(gx0) / 64 - 1, 0, grid->words_per_row - 1);
+    int w1 = std::clamp((int)std::floor(gx1) / 64 + 1, 0, grid->words_per_row - 1);
+    int r0 = std::clamp((int)std::floor(gy0) + 1 - 2, 0, grid->rows - 1);
+    int r1 = std::clamp((int)std::floor(gy1) + 1 + 2, 0, grid->rows - 1);
+
+    winRow0 = r0;
+    winRows = r1 - r0 + 1;
+    winWord0 = w0;
+    winWords = w1 - w0 + 1;
 }
 
 void Renderer::render() {
-    texture->update(grid->rows * grid->words_per_row * sizeof(uint32_t) * 2, grid->getGrid32Ptr());
+    TRACE_SCOPE("render");
+    lodLevel = selectLevel();
+    if (lodLevel == 0) {
+        updateWindow();
+        // Without heat map the cells out of the window are drawn like dead ones: the window shrinks to the rows holding
+        // live cells, down to a single row when none does
+        if (!grid->getHeatPtr()) {
+            const std::vector<uint8_t>& live = grid->rowLive;
+            int r0 = winRow0, r1 = winRow0 + winRows - 1;
+            while (r0 < r1 && !live[r0]) ++r0;
+            while (r1 > r0 && !live[r1]) --r1;
+            winRow0 = r0;
+            winRows = r1 - r0 + 1;
+        }
+        size_t bytes = (size_t)winRows * winWords * sizeof(uint64_t);
+        if (bytes > textureBytes) {
+            texture->allocate(GL_RG32UI, bytes, nullptr);
+            textureBytes = bytes;
+        }
+
+        // Full rows are contiguous in the grid, otherwise the window is packed first
+        const uint64_t* data = grid->getGridPtr();
+        if (winWords == grid->words_per_row) {
+            texture->update(bytes, data + (size_t)winRow0 * grid->words_per_row);
+        } else {
+            window.resize((size_t)winRows * winWords);
+            for (int r = 0; r < winRows; ++r) {
+                const uint64_t* src = data + (size_t)(winRow0 + r) * grid->words_per_row + winWord0;
+                std::copy(src, src + winWords, window.begin() + (size_t)r * winWords);
+            }
+            texture->update(bytes, window.data());
+        }
+
+        // Heat map planes of the window, interleaved by 4 words like in the grid
+        if (const uint64_t* heat = grid->getHeatPtr()) {
+            size_t hbytes = bytes * 4;
+            if (hbytes > heatBytes) {
+                heatTexture->allocate(GL_RG32UI, hbytes, nullptr);
+                heatBytes = hbytes;
+            }
+            if (winWords == grid->words_per_row) {
+                heatTexture->update(hbytes, heat + (size_t)winRow0 * grid->words_per_row * 4);
+            } else {
+                heatWindow.resize((size_t)winRows * winWords * 4);
+                for (int r = 0; r < winRows; ++r) {
+                    const uint64_t* src = heat + ((size_t)(winRow0 + r) * grid->words_per_row + winWord0) * 4;
+                    std::copy(src, src + winWords * 4, heatWindow.begin() + (size_t)r * winWords * 4);
+                }
+                heatTexture->update(hbytes, heatWindow.data());
+            }
+        }
+    } else {
+        // Only the counts of the drawn level are uploaded
+        pyramid.update(lodLevel);
+        const std::vector<uint16_t>& counts = pyramid.getLevel(lodLevel);
+        size_t bytes = counts.size() * sizeof(uint16_t);
+        if (bytes != lodBytes) {
+            lodTexture->allocate(GL_R16UI, bytes, counts.data());
+            lodBytes = bytes;
+        } else {
+            lodTexture->update(bytes, counts.data());
+        }
+    }
 
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
     shaders->use();
     texture->bind(0);
-    glUniform1i(glGetUniformLocation(shaders->get(), "packedGrid"), 0);
-    glUniform1i(glGetUniformLocation(shaders->get(), "leftpad"), grid->leftpad);
-    glUniform2f(glGetUniformLocation(shaders->get(), "windowSize"), cfg->width, cfg->height);
-    glUniform2f(glGetUniformLocation(shaders->get(), "gridSize"), cfg->gridx, cfg->gridy);
-    glUniform1i(glGetUniformLocation(shaders->get(), "words_per_row"), grid->words_per_row);
-    glUniform1f(glGetUniformLocation(shaders->get(), "zoom"), zoom);
-    glUniform2f(glGetUniformLocation(shaders->get(), "camera"), camX, camY);
+    shaders->setInt(uPackedGrid, 0);
+    lodTexture->bind(1);
+    shaders->setInt(uLodGrid, 1);
+    heatTexture->bind(2);
+    shaders->setInt(uHeatGrid, 2);
+    shaders->setInt(uHeatmap, grid->getHeatPtr() ? 1 : 0);
+    shaders->setInt(uLodLevel, lodLevel);
+    shaders->setInt(uLodWidth, lodLevel ? pyramid.levelWidth(lodLevel) : 0);
+    shaders->setVec2(uWindowSize, cfg->width, cfg->height);
+    shaders->setVec2(uGridSize, cfg->gridx, cfg->gridy);
+    shaders->setInt(uWinRow0, winRow0);
+    shaders->setInt(uWinRows, winRows);
+    shaders->setInt(uWinWord0, winWord0);
+    shaders->setInt(uWinWords, winWords);
+    shaders->setFloat(uZoom, zoom);
+    shaders->setVec2(uCamera, camX, camY);
     vao->bind();
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
\ No newline at end of file
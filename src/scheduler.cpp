@@ -0,0 +1,89 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+static double seconds(std::chrono::steady_clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+Scheduler::Scheduler() {
+
+}
+
+Scheduler::~Scheduler() {
+
+}
+
+// Set the target rate in generations per second, 0 for as fast as possible
+void Scheduler::setRate(double gensPerSecond) {
+    rate = std::max(0.0, gensPerSecond);
+    debt = 0.0;
+}
+
+double Scheduler::getRate() const {
+    return rate;
+}
+
+double Scheduler::getAchievedRate() const {
+    return achieved;
+}
+
+// Do the steps due for this frame, without going over the frame budget. Returns the number of steps done
+int Scheduler::run(Grid& grid) {
+    auto now = clock::now();
+    if (!running) {
+        // First frame after a pause: one step right away, no burst for the paused time
+        running = true;
+        last = now;
+        windowStart = now;
+        windowSteps = 0;
+        debt = 1.0;
+    }
+
+    int done = 0;
+    if (rate <= 0.0) {
+        do {
+            grid.step();
+            ++done;
+        } while (seconds(clock::now() - now) < frameBudget);
+    } else {
+        debt += seconds(now - last) * rate;
+        last = now;
+        while (debt >= 1.0) {
+            grid.step();
+            ++done;
+            debt -= 1.0;
+            // Steps that do not fit in the frame are dropped instead of piling up
+            if (seconds(clock::now() - now) >= frameBudget) {
+                debt = std::min(debt, 1.0);
+                break;
+            }
+        }
+    }
+
+    measure(done, clock::now());
+    return done;
+}
+
+// Called while paused
+void Scheduler::stop() {
+    running = false;
+    achieved = 0.0;
+}
+
+// Seconds until the next step is due, 0 when a step is due now or the rate is uncapped
+double Scheduler::timeToNextStep() const {
+    if (!running || rate <= 0.0) return 0.0;
+    double wait = (1.0 - debt) / rate - seconds(clock::now() - last);
+    return std::max(0.0, wait);
+}
+
+void Scheduler::measure(int steps, clock::time_point now) {
+    windowSteps += steps;
+    double dt = seconds(now - windowStart);
+    if (dt >= 0.5) {
+        achieved = windowSteps / dt;
+        windowStart = now;
+        windowSteps = 0;
+    }
+}
@@ -0,0 +1,351 @@
+#include "search.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+// Soups run by one task of the pool
+static constexpr uint64_t soupsPerTask = 64;
+
+// Seconds between two progress lines
+static constexpr double progressInterval = 0.25;
+
+Search::Search(const Config* cfg) {
+    this->cfg = cfg;
+    for (size_t i = 0; i < shardCount; ++i) shards.push_back(std::make_unique<Shard>());
+}
+
+Search::~Search() {
+
+}
+
+// Cell at (x, y) of the bounding box
+bool Search::Pattern::get(int x, int y) const {
+    return (bits[(size_t)y * w_for_w(width) + x / 64] >> (x % 64)) & 1ULL;
+}
+
+// Hash of the cells and the size of the box, independent of its position
+uint64_t Search::Pattern::hash() const {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ ((uint64_t)width << 32 | (uint32_t)height);
+    h = (h ^ (h >> 31)) * 0xff51afd7ed558ccdULL;
+    for (uint64_t w : bits) {
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+// Run every soup and write the findings
+void Search::run() {
+    Config local = *cfg;
+    auto [ok, msg] = local.parseRuleset(cfg->searchRuleset);
+    if (!ok) throw std::runtime_error("[Fatal] Bad search ruleset: " + cfg->searchRuleset);
+    rule = "B";
+    for (int i = 0; i < 9; ++i) if (local.born_rule & (1 << i)) rule += std::to_string(i);
+    rule += "/S";
+    for (int i = 0; i < 9; ++i) if (local.survive_rule & (1 << i)) rule += std::to_string(i);
+
+    int n = cfg->searchSoupSize;
+    if (n < 1 || n > 64 || n > cfg->searchGrid - 2) {
+        throw std::runtime_error(std::format("[Fatal] Bad search soup size {} for a {}x{} grid", n, cfg->searchGrid, cfg->searchGrid));
+    }
+    bool enumerate = (cfg->searchMode == "enumerate");
+    if (!enumerate && cfg->searchMode != "random") throw std::runtime_error("[Fatal] Bad search mode: " + cfg->searchMode);
+    if (enumerate && n * n > 63) throw std::runtime_error("[Fatal] Enumerated soups are at most 7x7 cells");
+
+    uint64_t soups = (uint64_t)std::max(0, cfg->searchSoups);
+    if (enumerate) soups = std::min<uint64_t>(soups, 1ULL << (n * n));
+
+    // Soups are the unit of parallelism, each tiny grid is stepped by a single thread and reused by every soup
+    int threads = cfg->threads > 0 ? cfg->threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t tasks = (size_t)((soups + soupsPerTask - 1) / soupsPerTask);
+    threads = std::max(1, std::min<int>(threads, (int)std::max<size_t>(1, tasks)));
+
+    local.gridx = cfg->searchGrid;
+    local.gridy = cfg->searchGrid;
+    local.threads = 1;
+    local.unbounded = false;
+    local.heatmap = false;
+    std::vector<Config> locals(threads, local);
+    std::vector<std::unique_ptr<Grid>> grids;
+    std::vector<std::vector<uint64_t>> words(threads);
+    for (int t = 0; t < threads; ++t) {
+        grids.push_back(std::make_unique<Grid>());
+        grids[t]->cfg = &locals[t];
+        grids[t]->initSize();
+        grids[t]->initMask();
+        grids[t]->initRuleset();
+        words[t].resize((size_t)grids[t]->rows * grids[t]->words_per_row);
+    }
+
+    std::cerr << std::format("[Info] search: {} soups of {}x{} cells in {} on {}x{} grids\n", soups, n, n, rule, cfg->searchGrid, cfg->searchGrid);
+    std::atomic<size_t> done = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto lastProgress = start;
+
+    // Progress is only printed by the calling thread (worker 0), so the lines of the workers never interleave
+    pool.run(threads, tasks, [&](int worker, size_t task) {
+        uint64_t first = task * soupsPerTask;
+        uint64_t last = std::min(soups, first + soupsPerTask);
+        for (uint64_t soup = first; soup < last; ++soup) {
+            runSoup(*grids[worker], soup, words[worker]);
+        }
+        size_t d = ++done;
+        auto now = std::chrono::steady_clock::now();
+        if (worker == 0 && std::chrono::duration<double>(now - lastProgress).count() >= progressInterval) {
+            lastProgress = now;
+            std::cerr << std::format("\r[Info] search: {}/{} soups", std::min<uint64_t>(d * soupsPerTask, soups), soups) << std::flush;
+        }
+    });
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << std::format("\r[Info] search: {}/{} soups\n", soups, soups);
+    write(elapsed);
+}
+
+// Write the soup in the middle of the empty grid: random cells of density search.density, or the bits of the soup index
+void Search::seedSoup(Grid& grid, uint64_t soup, std::vector<uint64_t>& words) const {
+    std::fill(words.begin(), words.end(), 0ULL);
+    int n = cfg->searchSoupSize;
+    int wpr = grid.words_per_row;
+    int x0 = (cfg->searchGrid - n) / 2;
+    int y0 = (cfg->searchGrid - n) / 2;
+    uint64_t mask = (n >= 64) ? ~0ULL : (1ULL << n) - 1;
+    bool enumerate = (cfg->searchMode == "enumerate");
+
+    for (int r = 0; r < n; ++r) {
+        uint64_t bits = enumerate ? (soup >> (r * n)) & mask
+                                  : philox_bernoulli((uint32_t)cfg->searchSeed, soup * n + r, cfg->searchDensity) & mask;
+        size_t row = (size_t)(y0 + r + 1) * wpr;
+        int q = x0 / 64, o = x0 % 64;
+        words[row + q] |= bits << o;
+        if (o && q + 1 < wpr) words[row + q + 1] |= bits >> (64 - o);
+    }
+    grid.restore(words, 0);
+}
+
+// Bounding box of the live cells of the grid, false when the grid is empty
+bool Search::extract(const Grid& grid, Pattern& p) const {
+    const uint64_t* data = grid.getGridPtr();
+    int wpr = grid.words_per_row;
+    int top = -1, bottom = -1, left = INT32_MAX, right = -1;
+    for (int r = 1; r < grid.rows - 1; ++r) {
+        const uint64_t* row = data + (size_t)r * wpr;
+        for (int w = 0; w < wpr; ++w) {
+            if (!row[w]) continue;
+            left = std::min(left, w * 64 + std::countr_zero(row[w]));
+            right = std::max(right, w * 64 + 63 - std::countl_zero(row[w]));
+            if (top < 0) top = r;
+            bottom = r;
+        }
+    }
+    if (top < 0) return false;
+
+    p.x0 = left;
+    p.y0 = top - 1;
+    p.width = right - left + 1;
+    p.height = bottom - top + 1;
+    int pw = w_for_w(p.width);
+    uint64_t tail = (p.width % 64) ? (1ULL << (p.width % 64)) - 1 : ~0ULL;
+    p.bits.assign((size_t)p.height * pw, 0ULL);
+
+    // Rows moved to the left by x0 bits
+    int q = left / 64, o = left % 64;
+    for (int y = 0; y < p.height; ++y) {
+        const uint64_t* row = data + (size_t)(top + y) * wpr;
+        for (int k = 0; k < pw; ++k) {
+            uint64_t lo = (q + k < wpr) ? row[q + k] >> o : 0ULL;
+            uint64_t hi = (o && q + k + 1 < wpr) ? row[q + k + 1] << (64 - o) : 0ULL;
+            p.bits[(size_t)y * pw + k] = lo | hi;
+        }
+        p.bits[(size_t)y * pw + pw - 1] &= tail;
+    }
+    return true;
+}
+
+// One of the 8 symmetries of the square: bit 0 swaps x and y, bit 1 mirrors x, bit 2 mirrors y
+Search::Pattern Search::transform(const Pattern& p, int sym) const {
+    Pattern t;
+    t.width = (sym & 1) ? p.height : p.width;
+    t.height = (sym & 1) ? p.width : p.height;
+    int pw = w_for_w(t.width);
+    t.bits.assign((size_t)t.height * pw, 0ULL);
+    for (int y = 0; y < p.height; ++y) {
+        for (int x = 0; x < p.width; ++x) {
+            if (!p.get(x, y)) continue;
+            int tx = (sym & 1) ? y : x;
+            int ty = (sym & 1) ? x : y;
+            if (sym & 2) tx = t.width - 1 - tx;
+            if (sym & 4) ty = t.height - 1 - ty;
+            t.bits[(size_t)ty * pw + tx / 64] |= 1ULL << (tx % 64);
+        }
+    }
+    return t;
+}
+
+// Run length encoded pattern, lines of at most 70 characters
+std::string Search::toRle(const Pattern& p) const {
+    std::vector<std::string> tokens;
+    auto put = [&](int count, char c) {
+        tokens.push_back((count > 1 ? std::to_string(count) : "") + c);
+    };
+
+    // Row ends are written before the next non empty row, dead cells at the end of a row are implicit
+    int ends = 0;
+    for (int y = 0; y < p.height; ++y) {
+        int x = 0;
+        while (x < p.width) {
+            bool alive = p.get(x, y);
+            int run = 1;
+            while (x + run < p.width && p.get(x + run, y) == alive) ++run;
+            if (alive || x + run < p.width) {
+                if (ends) put(ends, '$');
+                ends = 0;
+                put(run, alive ? 'o' : 'b');
+            }
+            x += run;
+        }
+        ++ends;
+    }
+    tokens.push_back("!");
+
+    std::string out = std::format("x = {}, y = {}, rule = {}\n", p.width, p.height, rule);
+    size_t line = 0;
+    for (const auto& t : tokens) {
+        if (line + t.size() > 70) {
+            out += "\n";
+            line = 0;
+        }
+        out += t;
+        line += t.size();
+    }
+    return out + "\n";
+}
+
+// Step a soup until its pattern repeats up to a translation, then record the object in its canonical form
+void Search::runSoup(Grid& grid, uint64_t soup, std::vector<uint64_t>& words) {
+    seedSoup(grid, soup, words);
+
+    // Hash and position of the last generations, a repeated hash gives the period and the displacement
+    struct Seen {
+        uint64_t hash;
+        int x0, y0;
+    };
+    int window = std::max(1, cfg->searchPeriod);
+    std::vector<Seen> seen(window);
+    int size = cfg->searchGrid;
+    Pattern p;
+
+    for (int s = 0; s <= cfg->searchSteps; ++s) {
+        if (!extract(grid, p)) {
+            ++dead;
+            return;
+        }
+        // Cells on the border would have been influenced by the dead cells outside the grid
+        if (p.x0 == 0 || p.y0 == 0 || p.x0 + p.width == size || p.y0 + p.height == size) {
+            ++escaped;
+            return;
+        }
+
+        uint64_t h = p.hash();
+        for (int k = 1; k <= std::min(s, window); ++k) {
+            const Seen& old = seen[(s - k) % window];
+            if (old.hash != h) continue;
+
+            SearchFind find;
+            find.period = k;
+            find.dx = std::max(std::abs(p.x0 - old.x0), std::abs(p.y0 - old.y0));
+            find.dy = std::min(std::abs(p.x0 - old.x0), std::abs(p.y0 - old.y0));
+
+            // Canonical form: lowest hash over the phases of the period and the symmetries of the square
+            Pattern canon;
+            find.id = ~0ULL;
+            for (int phase = 0; phase < k; ++phase) {
+                if (phase) {
+                    grid.step();
+                    extract(grid, p);
+                }
+                for (int sym = 0; sym < 8; ++sym) {
+                    Pattern t = transform(p, sym);
+                    uint64_t id = t.hash();
+                    if (id < find.id) {
+                        find.id = id;
+                        canon = std::move(t);
+                    }
+                }
+            }
+            record(std::move(find), canon, soup);
+            return;
+        }
+        seen[s % window] = {h, p.x0, p.y0};
+        grid.step();
+    }
+    ++unresolved;
+}
+
+// Count a finding in the shared set, the first soup giving an object fills its description
+void Search::record(SearchFind&& find, const Pattern& canon, uint64_t soup) {
+    Shard& shard = *shards[find.id % shardCount];
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.finds.find(find.id);
+    if (it != shard.finds.end()) {
+        ++it->second.count;
+        it->second.firstSoup = std::min(it->second.firstSoup, soup);
+        return;
+    }
+    find.count = 1;
+    find.firstSoup = soup;
+    find.width = canon.width;
+    find.height = canon.height;
+    for (uint64_t w : canon.bits) find.population += std::popcount(w);
+    find.rle = toRle(canon);
+    shard.finds.emplace(find.id, std::move(find));
+}
+
+// Findings as RLE patterns with their statistics: still lifes, oscillators then spaceships, most common first
+void Search::write(double seconds) {
+    std::vector<SearchFind> finds;
+    for (auto& shard : shards) {
+        for (auto& [id, f] : shard->finds) finds.push_back(std::move(f));
+    }
+    auto kind = [](const SearchFind& f) { return (f.dx || f.dy) ? 2 : (f.period > 1 ? 1 : 0); };
+    std::sort(finds.begin(), finds.end(), [&](const SearchFind& a, const SearchFind& b) {
+        if (kind(a) != kind(b)) return kind(a) < kind(b);
+        if (a.count != b.count) return a.count > b.count;
+        return a.id < b.id;
+    });
+
+    uint64_t counts[3] = {0, 0, 0};
+    uint64_t objects[3] = {0, 0, 0};
+    for (const auto& f : finds) {
+        counts[kind(f)] += f.count;
+        ++objects[kind(f)];
+    }
+    uint64_t soups = counts[0] + counts[1] + counts[2] + dead + escaped + unresolved;
+
+    std::ofstream ofs(cfg->searchOutput);
+    if (!ofs) throw std::runtime_error("[Fatal] Cannot open search output: " + cfg->searchOutput);
+    ofs << std::format("#C Search of {}: {} soups, {} distinct objects\n", rule, soups, finds.size());
+    ofs << std::format("#C {} still lifes, {} oscillators, {} spaceships, {} dead, {} escaped, {} unresolved\n\n",
+        counts[0], counts[1], counts[2], dead.load(), escaped.load(), unresolved.load());
+
+    static const char* names[3] = {"still life", "oscillator", "spaceship"};
+    for (const auto& f : finds) {
+        std::string speed = kind(f) == 2 ? std::format(", speed ({},{})c/{}", f.dx, f.dy, f.period) : "";
+        ofs << std::format("#N {} p{}{}\n", names[kind(f)], f.period, speed);
+        ofs << std::format("#C {} cells, {} soups, first soup {}, id {:016x}\n", f.population, f.count, f.firstSoup, f.id);
+        ofs << f.rle << "\n";
+    }
+
+    std::cerr << std::format("[Info] {} soups in {:.2f} s ({:.0f} soups/s)\n", soups, seconds, seconds > 0.0 ? soups / seconds : 0.0);
+    std::cerr << std::format("[Info] {} still lifes ({} kinds), {} oscillators ({} kinds), {} spaceships ({} kinds)\n",
+        counts[0], objects[0], counts[1], objects[1], counts[2], objects[2]);
+    std::cerr << std::format("[Info] {} dead, {} escaped, {} unresolved. Findings written to {}\n",
+        dead.load(), escaped.load(), unresolved.load(), cfg->searchOutput);
+}
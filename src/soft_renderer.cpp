@@ -0,0 +1,279 @@
+#include "soft_renderer.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static constexpr const char* pipeMode = "wb";
+#else
+static constexpr const char* pipeMode = "w";
+#endif
+
+// Colors packed as RGBA bytes in memory (little endian)
+static constexpr uint32_t clearColor = 0xFF1A1A1A; // glClearColor(0.1, 0.1, 0.1, 1.0)
+static constexpr uint32_t deadColor  = 0xFF000000;
+static constexpr uint32_t aliveBits  = 0x00FFFFFF;
+
+// Heat map colors by age, the same ramp as heatColor() in the fragment shader
+static uint32_t heatColor(int age) {
+    float t = 1.0f - age / 15.0f;
+    float r = std::clamp(2.0f * t, 0.0f, 1.0f);
+    float g = std::clamp(2.0f * t - 1.0f, 0.0f, 1.0f) * 0.85f;
+    return 0xFF000000u | ((uint32_t)(g * 255.0f + 0.5f) << 8) | (uint32_t)(r * 255.0f + 0.5f);
+}
+
+SoftRenderer::SoftRenderer(const Grid* grid, const Config* cfg) {
+    this->grid = grid;
+    this->cfg = cfg;
+
+    int n = cfg->threads > 0 ? cfg->threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    workers.init(n);
+    resize(cfg->width, cfg->height);
+}
+
+// Set the output size in pixels
+void SoftRenderer::resize(int w, int h) {
+    width = w;
+    height = h;
+    pixels.assign((size_t)width * height * 4, 0);
+    colWord.resize(width);
+    colBit.resize(width);
+    colKeep.resize(width);
+    colBase.resize(width);
+}
+
+// Horizontal mapping from pixel columns to grid cells, the same for every row
+void SoftRenderer::initColumns() {
+    float windowAspect = (float)width / (float)height;
+    float gridAspect   = (float)cfg->gridx / (float)cfg->gridy;
+
+    for (int px = 0; px < width; ++px) {
+        float fragX = px + 0.5f;
+        float correctedX = fragX;
+        if (windowAspect > gridAspect) {
+            float scale = windowAspect / gridAspect;
+            correctedX = (fragX - 0.5f * width) * scale + 0.5f * width;
+        }
+        float gx_f = camX + (correctedX - 0.5f) * ((float)cfg->gridx / width) / zoom;
+        int gx = (int)gx_f;
+
+        if (gx < 0 || gx >= cfg->gridx) {
+            colWord[px] = 0;
+            colBit[px] = 0;
+            colKeep[px] = 0;
+            colBase[px] = clearColor;
+        } else {
+            colWord[px] = gx / 64;
+            colBit[px] = gx % 64;
+            colKeep[px] = 1;
+            colBase[px] = deadColor;
+        }
+    }
+}
+
+// Render the current grid, rows are split between the workers
+void SoftRenderer::render() {
+    initColumns();
+
+    float windowAspect = (float)width / (float)height;
+    float gridAspect   = (float)cfg->gridx / (float)cfg->gridy;
+    const uint64_t* data = grid->getGridPtr();
+    const uint64_t* heat = grid->getHeatPtr();
+    int wpr = grid->words_per_row;
+    int n = workers.size();
+
+    uint32_t heatColors[16];
+    for (int a = 0; a < 16; ++a) heatColors[a] = heatColor(a);
+
+    workers.run([&](int b) {
+        int i0 = (int)((int64_t)height * b / n);
+        int i1 = (int)((int64_t)height * (b + 1) / n);
+        for (int i = i0; i < i1; ++i) {
+            uint32_t* out = reinterpret_cast<uint32_t*>(pixels.data()) + (size_t)i * width;
+
+            // Image rows are top first, fragment coordinates are bottom first
+            float fragY = (height - 1 - i) + 0.5f;
+            float correctedY = fragY;
+            if (windowAspect <= gridAspect) {
+                float scale = gridAspect / windowAspect;
+                correctedY = (fragY - 0.5f * height) * scale + 0.5f * height;
+            }
+            float gy_f = cfg->gridy - (camY + (correctedY + 0.5f) * ((float)cfg->gridy / height) / zoom);
+            int gy = (int)gy_f;
+
+            if (gy < 0 || gy >= cfg->gridy) {
+                std::fill(out, out + width, clearColor);
+                continue;
+            }
+
+            // Branch free bit expansion, one gathered bit per pixel, vectorized by the compiler
+            const uint64_t* row = data + (size_t)(gy + 1) * wpr;
+            for (int px = 0; px < width; ++px) {
+                uint64_t alive = (row[colWord[px]] >> colBit[px]) & colKeep[px];
+                out[px] = colBase[px] | ((uint32_t)(0 - alive) & aliveBits);
+            }
+
+            // Heat map: dead cells of the grid take the color of their age
+            if (heat) {
+                const uint64_t* planes = heat + (size_t)(gy + 1) * wpr * 4;
+                for (int px = 0; px < width; ++px) {
+                    if (!colKeep[px] || out[px] != deadColor) continue;
+                    const uint64_t* p = planes + (size_t)colWord[px] * 4;
+                    int b = colBit[px];
+                    int age = (int)(((p[0] >> b) & 1) | (((p[1] >> b) & 1) << 1) | (((p[2] >> b) & 1) << 2) | (((p[3] >> b) & 1) << 3));
+                    out[px] = heatColors[age];
+                }
+            }
+        }
+    });
+}
+
+// RGBA pixels, top row first
+const std::vector<uint8_t>& SoftRenderer::getPixels() const {
+    return pixels;
+}
+
+int SoftRenderer::getWidth() const {
+    return width;
+}
+
+int SoftRenderer::getHeight() const {
+    return height;
+}
+
+// CRC32 (PNG chunks) and Adler32 (zlib stream) checksums
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool init = false;
+    if (!init) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        init = true;
+    }
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static uint32_t adler32_update(uint32_t adler, const uint8_t* data, size_t size) {
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0) {
+        size_t n = std::min<size_t>(size, 5552);
+        size -= n;
+        while (n--) { a += *data++; b += a; }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void put_be32(std::vector<uint8_t>& v, uint32_t x) {
+    v.push_back(x >> 24); v.push_back(x >> 16); v.push_back(x >> 8); v.push_back(x);
+}
+
+FrameWriter::FrameWriter() {
+
+}
+
+FrameWriter::~FrameWriter() {
+    close();
+}
+
+// Open the output: '|command' pipes the frames to a command (ffmpeg for instance), anything else is a file path
+void FrameWriter::open(const std::string& target, const std::string& format) {
+    close();
+    if (format == "png") png = true;
+    else if (format == "raw") png = false;
+    else throw std::runtime_error("[Fatal] Bad export format: " + format);
+
+    if (target.starts_with("|")) {
+        out = popen(target.substr(1).c_str(), pipeMode);
+        isPipe = true;
+    } else {
+        out = std::fopen(target.c_str(), "wb");
+        isPipe = false;
+    }
+    if (!out) throw std::runtime_error("[Fatal] Cannot open export output: " + target);
+}
+
+// Write one frame
+void FrameWriter::write(const std::vector<uint8_t>& rgba, int width, int height) {
+    if (!out) return;
+    if (png) {
+        writePng(rgba, width, height);
+    } else {
+        std::fwrite(rgba.data(), 1, rgba.size(), out);
+    }
+}
+
+// Close the output, waiting for the piped command to end
+void FrameWriter::close() {
+    if (!out) return;
+    if (isPipe) pclose(out);
+    else std::fclose(out);
+    out = nullptr;
+}
+
+// Write a PNG chunk with its length and CRC
+void FrameWriter::writeChunk(const char* type, const uint8_t* data, size_t size) {
+    std::vector<uint8_t> head;
+    put_be32(head, (uint32_t)size);
+    head.insert(head.end(), type, type + 4);
+    std::fwrite(head.data(), 1, head.size(), out);
+    if (size) std::fwrite(data, 1, size, out);
+
+    uint32_t crc = crc32_update(0xFFFFFFFFu, head.data() + 4, 4);
+    crc = crc32_update(crc, data, size) ^ 0xFFFFFFFFu;
+    std::vector<uint8_t> tail;
+    put_be32(tail, crc);
+    std::fwrite(tail.data(), 1, tail.size(), out);
+}
+
+// PNG with stored (uncompressed) deflate blocks: no zlib dependency and no time spent compressing
+void FrameWriter::writePng(const std::vector<uint8_t>& rgba, int width, int height) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::fwrite(signature, 1, 8, out);
+
+    std::vector<uint8_t> ihdr;
+    put_be32(ihdr, width);
+    put_be32(ihdr, height);
+    ihdr.insert(ihdr.end(), {8, 6, 0, 0, 0}); // 8 bits, RGBA, deflate, no filter, no interlace
+    writeChunk("IHDR", ihdr.data(), ihdr.size());
+
+    // Scanlines with filter type 0
+    size_t stride = (size_t)width * 4;
+    size_t rawSize = (stride + 1) * height;
+    std::vector<uint8_t> raw(rawSize);
+    for (int y = 0; y < height; ++y) {
+        raw[y * (stride + 1)] = 0;
+        std::memcpy(&raw[y * (stride + 1) + 1], &rgba[y * stride], stride);
+    }
+
+    // zlib stream made of stored blocks of at most 65535 bytes
+    scratch.clear();
+    scratch.reserve(rawSize + rawSize / 65535 * 5 + 16);
+    scratch.push_back(0x78);
+    scratch.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t n = std::min<size_t>(65535, rawSize - pos);
+        bool last = (pos + n == rawSize);
+        scratch.push_back(last ? 1 : 0);
+        scratch.push_back(n & 0xFF);
+        scratch.push_back(n >> 8);
+        scratch.push_back(~n & 0xFF);
+        scratch.push_back((~n >> 8) & 0xFF);
+        scratch.insert(scratch.end(), raw.begin() + pos, raw.begin() + pos + n);
+        pos += n;
+    } while (pos < rawSize);
+    put_be32(scratch, adler32_update(1, raw.data(), rawSize));
+    writeChunk("IDAT", scratch.data(), scratch.size());
+
+    writeChunk("IEND", nullptr, 0);
+}
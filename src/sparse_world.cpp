@@ -0,0 +1,220 @@
+#include "sparse_world.hpp"
+#include "grid.hpp"
+
+#include <cstring>
+#include <bit>
+
+// Floor division by the chunk size, for negative world coordinates
+static int64_t floordiv64(int64_t x) {
+    return (x >= 0) ? x / 64 : -((63 - x) / 64);
+}
+
+ChunkPool::ChunkPool() {
+
+}
+
+ChunkPool::~ChunkPool() {
+
+}
+
+// Get a zeroed chunk from the free list, or allocate a new block of chunks if empty
+Chunk* ChunkPool::acquire(int32_t cx, int32_t cy) {
+    if (freeList.empty()) {
+        blocks.push_back(std::make_unique<Chunk[]>(blockChunks));
+        Chunk* block = blocks.back().get();
+        for (size_t i = blockChunks; i > 0; --i) {
+            freeList.push_back(&block[i - 1]);
+        }
+    }
+    Chunk* chunk = freeList.back();
+    freeList.pop_back();
+    std::memset(chunk->cells, 0, sizeof(chunk->cells));
+    std::memset(chunk->next, 0, sizeof(chunk->next));
+    chunk->cx = cx;
+    chunk->cy = cy;
+    return chunk;
+}
+
+// Give a chunk back to the pool
+void ChunkPool::release(Chunk* chunk) {
+    freeList.push_back(chunk);
+}
+
+// Release every block of chunks
+void ChunkPool::clear() {
+    freeList.clear();
+    blocks.clear();
+}
+
+// Number of chunks allocated by the pool, used or not
+size_t ChunkPool::capacity() const {
+    return blocks.size() * blockChunks;
+}
+
+SparseWorld::SparseWorld() {
+
+}
+
+SparseWorld::~SparseWorld() {
+
+}
+
+// Remove every chunk of the world
+void SparseWorld::clear() {
+    chunks.clear();
+    pool.clear();
+    lastKey = ~0ULL;
+    lastChunk = nullptr;
+}
+
+// Set born and survive masks
+void SparseWorld::setRules(uint16_t born, uint16_t survive) {
+    born_rule = born;
+    survive_rule = survive;
+}
+
+// Pack chunk coordinates in a single hash map key
+uint64_t SparseWorld::key(int32_t cx, int32_t cy) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+}
+
+// Find a chunk by its coordinates, nullptr if not allocated
+Chunk* SparseWorld::findChunk(int32_t cx, int32_t cy) const {
+    uint64_t k = key(cx, cy);
+    if (k == lastKey) return lastChunk;
+    auto it = chunks.find(k);
+    lastKey = k;
+    lastChunk = (it == chunks.end()) ? nullptr : it->second;
+    return lastChunk;
+}
+
+// Find a chunk by its coordinates, allocate it from the pool if not present
+Chunk* SparseWorld::getOrCreate(int32_t cx, int32_t cy) {
+    Chunk* chunk = findChunk(cx, cy);
+    if (chunk) return chunk;
+    chunk = pool.acquire(cx, cy);
+    chunks.emplace(key(cx, cy), chunk);
+    lastKey = key(cx, cy);
+    lastChunk = chunk;
+    return chunk;
+}
+
+// Set the 64 cells starting at (x, y) to alive where bits are set
+void SparseWorld::orWord(int64_t x, int64_t y, uint64_t bits) {
+    if (!bits) return;
+    int64_t cx = floordiv64(x);
+    int64_t cy = floordiv64(y);
+    int o = static_cast<int>(x - cx * 64);
+    int row = static_cast<int>(y - cy * 64);
+
+    if (bits << o) getOrCreate(cx, cy)->cells[row] |= bits << o;
+    if (o && (bits >> (64 - o))) getOrCreate(cx + 1, cy)->cells[row] |= bits >> (64 - o);
+}
+
+// Get the 64 cells starting at (x, y)
+uint64_t SparseWorld::getWord(int64_t x, int64_t y) const {
+    int64_t cx = floordiv64(x);
+    int64_t cy = floordiv64(y);
+    int o = static_cast<int>(x - cx * 64);
+    int row = static_cast<int>(y - cy * 64);
+
+    uint64_t word = 0ULL;
+    if (const Chunk* a = findChunk(cx, cy)) word |= a->cells[row] >> o;
+    if (o) {
+        if (const Chunk* b = findChunk(cx + 1, cy)) word |= b->cells[row] << (64 - o);
+    }
+    return word;
+}
+
+// Step function of the whole world
+void SparseWorld::step() {
+    // Allocate the neighbours of the chunks having live cells on their border, births can happen there
+    std::vector<std::pair<int32_t, int32_t>> spawn;
+    for (const auto& [k, c] : chunks) {
+        uint64_t west = 0ULL, east = 0ULL;
+        for (int y = 0; y < 64; ++y) {
+            west |= c->cells[y] & 1ULL;
+            east |= c->cells[y] >> 63;
+        }
+        uint64_t north = c->cells[0], south = c->cells[63];
+
+        if (north) spawn.emplace_back(c->cx, c->cy - 1);
+        if (south) spawn.emplace_back(c->cx, c->cy + 1);
+        if (west) spawn.emplace_back(c->cx - 1, c->cy);
+        if (east) spawn.emplace_back(c->cx + 1, c->cy);
+        if (north & 1ULL) spawn.emplace_back(c->cx - 1, c->cy - 1);
+        if (north >> 63) spawn.emplace_back(c->cx + 1, c->cy - 1);
+        if (south & 1ULL) spawn.emplace_back(c->cx - 1, c->cy + 1);
+        if (south >> 63) spawn.emplace_back(c->cx + 1, c->cy + 1);
+    }
+    for (const auto& [cx, cy] : spawn) {
+        getOrCreate(cx, cy);
+    }
+
+    // Compute the next generation of every chunk, missing neighbours are dead cells
+    static const Chunk empty{};
+    auto neighbour = [&](int32_t cx, int32_t cy) -> const Chunk* {
+        const Chunk* n = findChunk(cx, cy);
+        return n ? n : &empty;
+    };
+
+    for (const auto& [k, c] : chunks) {
+        const Chunk* n  = neighbour(c->cx,     c->cy - 1);
+        const Chunk* s  = neighbour(c->cx,     c->cy + 1);
+        const Chunk* w  = neighbour(c->cx - 1, c->cy);
+        const Chunk* e  = neighbour(c->cx + 1, c->cy);
+        const Chunk* nw = neighbour(c->cx - 1, c->cy - 1);
+        const Chunk* ne = neighbour(c->cx + 1, c->cy - 1);
+        const Chunk* sw = neighbour(c->cx - 1, c->cy + 1);
+        const Chunk* se = neighbour(c->cx + 1, c->cy + 1);
+
+        for (int y = 0; y < 64; ++y) {
+            uint64_t tl, t, tr, bl, b, br;
+            if (y > 0) {
+                tl = w->cells[y-1]; t = c->cells[y-1]; tr = e->cells[y-1];
+            } else {
+                tl = nw->cells[63]; t = n->cells[63]; tr = ne->cells[63];
+            }
+            if (y < 63) {
+                bl = w->cells[y+1]; b = c->cells[y+1]; br = e->cells[y+1];
+            } else {
+                bl = sw->cells[0]; b = s->cells[0]; br = se->cells[0];
+            }
+            c->next[y] = next_word(tl, t, tr, w->cells[y], c->cells[y], e->cells[y], bl, b, br, born_rule, survive_rule);
+        }
+    }
+
+    // Swap buffers and give empty chunks back to the pool
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        Chunk* c = it->second;
+        uint64_t any = 0ULL;
+        for (int y = 0; y < 64; ++y) {
+            c->cells[y] = c->next[y];
+            any |= c->cells[y];
+        }
+        if (!any) {
+            pool.release(c);
+            it = chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    lastKey = ~0ULL;
+    lastChunk = nullptr;
+}
+
+// Number of allocated chunks
+size_t SparseWorld::chunkCount() const {
+    return chunks.size();
+}
+
+// Number of live cells in the world
+uint64_t SparseWorld::population() const {
+    uint64_t pop = 0;
+    for (const auto& [k, c] : chunks) {
+        for (int y = 0; y < 64; ++y) {
+            pop += std::popcount(c->cells[y]);
+        }
+    }
+    return pop;
+}
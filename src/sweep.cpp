@@ -0,0 +1,156 @@
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+// Seconds between two progress lines
+static constexpr double progressInterval = 0.25;
+
+Sweep::Sweep(const Config* cfg) {
+    this->cfg = cfg;
+}
+
+Sweep::~Sweep() {
+
+}
+
+// Run every combination and write the summary
+void Sweep::run() {
+    std::vector<Params> params;
+    for (const auto& r : cfg->sweepRulesets)
+        for (const auto& d : cfg->sweepDists)
+            for (float density : cfg->sweepDensities)
+                for (int seed : cfg->sweepSeeds)
+                    params.push_back({r, d, density, seed});
+
+    // Runs are the unit of parallelism, each grid is stepped by a single thread
+    int threads = cfg->threads > 0 ? cfg->threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1, std::min<int>(threads, (int)params.size()));
+
+    // One config and one grid per worker, the grid buffers are allocated once and reused by every run
+    std::vector<Config> locals(threads, *cfg);
+    std::vector<std::unique_ptr<Grid>> grids;
+    for (int t = 0; t < threads; ++t) {
+        locals[t].threads = 1;
+        locals[t].unbounded = false;
+        locals[t].heatmap = false;
+        locals[t].randomSeed = false;
+        grids.push_back(std::make_unique<Grid>());
+        grids[t]->cfg = &locals[t];
+        grids[t]->initSize();
+        grids[t]->initMask();
+    }
+
+    std::vector<SweepResult> results(params.size());
+    std::atomic<size_t> done = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto lastProgress = start;
+
+    // Progress is only printed by the calling thread (worker 0), so the lines of the workers never interleave
+    pool.run(threads, params.size(), [&](int worker, size_t task) {
+        runOne(*grids[worker], locals[worker], params[task], results[task]);
+        size_t n = ++done;
+        auto now = std::chrono::steady_clock::now();
+        if (worker == 0 && std::chrono::duration<double>(now - lastProgress).count() >= progressInterval) {
+            lastProgress = now;
+            std::cerr << std::format("\r[Info] sweep: {}/{} runs", n, params.size()) << std::flush;
+        }
+    });
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << std::format("\r[Info] sweep: {}/{} runs", params.size(), params.size());
+    std::cerr << std::format("\n[Info] {} runs on {} threads in {:.2f} s\n", params.size(), threads, elapsed);
+    write(results);
+}
+
+// One run: step until the grid repeats a generation of the last period_max ones, or max_steps
+void Sweep::runOne(Grid& grid, Config& local, const Params& p, SweepResult& res) {
+    auto start = std::chrono::steady_clock::now();
+    res.ruleset = p.ruleset;
+    res.distType = p.distType;
+    res.density = p.density;
+    res.seed = p.seed;
+
+    if (!local.parseRuleset(p.ruleset).first || !local.parseDistType(p.distType).first) {
+        res.state = "invalid";
+        return;
+    }
+    local.rulestr = p.ruleset;
+    local.density = p.density;
+    local.seed = p.seed;
+
+    grid.initSeed();
+    grid.initRuleset();
+    grid.initRandomGrid();
+
+    // Hashes of the last generations, a repeated hash gives the period
+    int window = std::max(1, cfg->sweepPeriod);
+    std::vector<uint64_t> hashes(window, 0ULL);
+    int filled = 0;
+    hashes[0] = grid.hash();
+    filled = 1;
+
+    res.state = "unstable";
+    for (uint64_t s = 1; s <= (uint64_t)cfg->sweepSteps; ++s) {
+        grid.step();
+        uint64_t h = grid.hash();
+        int period = 0;
+        for (int k = 1; k <= std::min(filled, window); ++k) {
+            if (hashes[(s - k) % window] == h) {
+                period = k;
+                break;
+            }
+        }
+        hashes[s % window] = h;
+        filled = std::min(filled + 1, window);
+        res.steps = s;
+
+        if (period) {
+            res.period = period;
+            res.state = (period == 1) ? "still" : "periodic";
+            break;
+        }
+    }
+
+    res.population = grid.population();
+    if (res.population == 0) {
+        res.state = "dead";
+        res.period = 0;
+    }
+    res.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One row per run, in the order of the combinations
+void Sweep::write(const std::vector<SweepResult>& results) {
+    std::ofstream ofs(cfg->sweepOutput);
+    if (!ofs) throw std::runtime_error("[Fatal] Cannot open sweep output: " + cfg->sweepOutput);
+
+    if (cfg->sweepFormat == "json") {
+        json j = json::array();
+        for (const auto& r : results) {
+            j.push_back({
+                {"ruleset", r.ruleset}, {"dist_type", r.distType}, {"density", std::round(r.density * 1e6) / 1e6}, {"seed", r.seed},
+                {"steps", r.steps}, {"population", r.population}, {"state", r.state}, {"period", r.period}, {"ms", r.ms}
+            });
+        }
+        ofs << std::setw(4) << j << "\n";
+    } else if (cfg->sweepFormat == "csv") {
+        ofs << "ruleset,dist_type,density,seed,steps,population,state,period,ms\n";
+        for (const auto& r : results) {
+            ofs << std::format("{},{},{},{},{},{},{},{},{:.3f}\n",
+                r.ruleset, r.distType, r.density, r.seed, r.steps, r.population, r.state, r.period, r.ms);
+        }
+    } else {
+        throw std::runtime_error("[Fatal] Bad sweep format: " + cfg->sweepFormat);
+    }
+    std::cerr << "[Info] sweep summary written to " << cfg->sweepOutput << "\n";
+}
@@ -0,0 +1,64 @@
+#include "task_pool.hpp"
+
+#include <thread>
+#include <algorithm>
+
+TaskPool::TaskPool() {
+
+}
+
+TaskPool::~TaskPool() {
+
+}
+
+// Run count tasks on the given number of threads, the calling thread being worker 0. Returns when every task is done
+void TaskPool::run(int threads, size_t count, const std::function<void(int worker, size_t task)>& fn) {
+    threads = std::max(1, threads);
+    queues.clear();
+    for (int t = 0; t < threads; ++t) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    // Tasks are dealt round robin, stealing evens out the runs that end early
+    for (size_t i = 0; i < count; ++i) {
+        queues[i % threads]->tasks.push_back(i);
+    }
+
+    auto work = [&](int worker) {
+        size_t task;
+        while (take(worker, task)) {
+            fn(worker, task);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& th : pool) th.join();
+}
+
+// Next task of a worker: its own queue first, then the other ones. No task is added while running, so empty queues mean the end
+bool TaskPool::take(int worker, size_t& task) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    int n = (int)queues.size();
+    for (int k = 1; k < n; ++k) {
+        Queue& victim = *queues[(worker + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,114 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+// True when the trace macros are compiled in
+bool Trace::compiled() {
+#ifdef GOL_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Start recording, the events of a previous recording are dropped
+void Trace::start() {
+    since.store(now(), std::memory_order_release);
+    enabled.store(true, std::memory_order_release);
+}
+
+void Trace::stop() {
+    enabled.store(false, std::memory_order_release);
+}
+
+bool Trace::recording() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+// Steady clock in nanoseconds
+uint64_t Trace::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Ring of the calling thread, allocated on its first event
+Trace::Ring& Trace::ring() {
+    if (!mine) {
+        std::lock_guard<std::mutex> lock(mtx);
+        rings.push_back(std::make_unique<Ring>());
+        mine = rings.back().get();
+        mine->tid = (int)rings.size();
+        mine->name = threadName.empty() ? "thread " + std::to_string(mine->tid) : threadName;
+    }
+    return *mine;
+}
+
+// Append a complete event to the ring of the calling thread
+void Trace::record(const char* name, uint64_t start) {
+    Ring& r = ring();
+    uint64_t h = r.head.load(std::memory_order_relaxed);
+    r.events[h % ringSize] = {name, start, now() - start};
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+// Name shown for the calling thread in the trace viewer
+void Trace::nameThread(const std::string& name) {
+    threadName = name;
+    if (mine) {
+        std::lock_guard<std::mutex> lock(mtx);
+        mine->name = name;
+    }
+}
+
+// Write the events of every thread as Chrome trace JSON, times in microseconds. Returns the number of events
+size_t Trace::write(const std::string& path) {
+    struct Copy {
+        int tid;
+        std::string name;
+        std::vector<TraceEvent> events;
+    };
+    std::vector<Copy> copies;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& r : rings) {
+            Copy c{r->tid, r->name, {}};
+            uint64_t end = r->head.load(std::memory_order_acquire);
+            uint64_t begin = end > ringSize ? end - ringSize : 0;
+            uint64_t from = since.load(std::memory_order_acquire);
+            for (uint64_t i = begin; i < end; ++i) c.events.push_back(r->events[i % ringSize]);
+            // Events overwritten by the thread while copying are dropped, with the slot it may be writing now
+            uint64_t after = r->head.load(std::memory_order_acquire);
+            uint64_t valid = after + 1 > ringSize ? after + 1 - ringSize : 0;
+            if (valid > begin) c.events.erase(c.events.begin(), c.events.begin() + std::min<uint64_t>(valid - begin, c.events.size()));
+            std::erase_if(c.events, [&](const TraceEvent& e) { return e.start < from; });
+            copies.push_back(std::move(c));
+        }
+    }
+
+    uint64_t origin = ~0ULL;
+    for (const auto& c : copies) {
+        for (const auto& e : c.events) origin = std::min(origin, e.start);
+    }
+
+    std::ofstream ofs(path);
+    if (!ofs) throw std::runtime_error("[Fatal] Cannot open trace output: " + path);
+    ofs << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    size_t count = 0;
+    for (const auto& c : copies) {
+        ofs << (first ? "" : ",\n")
+            << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", c.tid, c.name);
+        first = false;
+        for (const auto& e : c.events) {
+            ofs << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                e.name, c.tid, (e.start - origin) / 1000.0, e.duration / 1000.0);
+            ++count;
+        }
+    }
+    ofs << "\n]}\n";
+    return count;
+}
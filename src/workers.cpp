@@ -0,0 +1,78 @@
+#include "workers.hpp"
+#include "trace.hpp"
+
+WorkerPool::WorkerPool() {
+
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+// Start n - 1 worker threads, the caller of run() being the first worker
+void WorkerPool::init(int n) {
+    if (n < 1) n = 1;
+    if (n == count) return;
+    stop();
+    count = n;
+    for (int i = 1; i < count; ++i) {
+        threads.emplace_back(&WorkerPool::loop, this, i, generation);
+    }
+}
+
+// Run fn(i) for each band index i in parallel and wait for all of them
+void WorkerPool::run(const std::function<void(int)>& fn) {
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = &fn;
+        pending = count - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    fn(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [&]{ return pending == 0; });
+    job = nullptr;
+}
+
+// Number of workers, the calling thread included
+int WorkerPool::size() const {
+    return count;
+}
+
+// Worker thread loop: wait for a new job, run its band and signal completion
+void WorkerPool::loop(int index, uint64_t seen) {
+    TRACE_THREAD("worker " + std::to_string(index));
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        wake.wait(lock, [&]{ return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+        const std::function<void(int)>* fn = job;
+
+        lock.unlock();
+        (*fn)(index);
+        lock.lock();
+
+        if (--pending == 0) done.notify_one();
+    }
+}
+
+// Join every worker thread
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+    threads.clear();
+    stopping = false;
+    count = 1;
+}